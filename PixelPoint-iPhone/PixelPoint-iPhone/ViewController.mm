@@ -9,12 +9,25 @@
 #import "ViewController.h"
 
 #include "PixelPointRenderer.h"
+#include "FrameExchange.h"
+#include "Dither.h"
+
+#include <atomic>
 
 #import <CoreImage/CoreImage.h>
+#import <QuartzCore/QuartzCore.h>
 #import <ImageIO/ImageIO.h>
 #import <AssertMacros.h>
 #import <AssetsLibrary/AssetsLibrary.h>
 
+// live frames are reduced to this many colors, with a palette built from the first frame after
+// pixelation is switched on and reused for the frames after it. 0 keeps full color
+static const size_t LIVE_PALETTE_COLORS = 0;
+
+// ordered dither costs the same every frame and doesn't crawl as the image moves, which error
+// diffusion does
+static const Dither::Mode LIVE_DITHER = Dither::Mode::Ordered;
+
 // used for KVO observation of the @"capturingStillImage" property to perform flash bulb animation
 static const NSString *AVCaptureStillImageIsCapturingStillImageContext = @"AVCaptureStillImageIsCapturingStillImageContext";
 
@@ -27,6 +40,23 @@ static const NSString *AVCaptureStillImageIsCapturingStillImageContext = @"AVCap
 
 @end
 
+// a pixelated camera frame, built on the capture queue and drawn on the main thread
+struct CameraFrame
+{
+    Scene scene;
+    CGSize imageSize;
+    CFTimeInterval captureTime;
+};
+
+// time from capture to the frame being drawn for present, in seconds, for reading in the debugger
+struct FrameLatency
+{
+    size_t frames;
+    double last;
+    double total;
+    double worst;
+};
+
 @implementation ViewController
 
 AVCaptureVideoPreviewLayer *previewLayer;
@@ -40,8 +70,12 @@ CIDetector *faceDetector;
 CGFloat beginGestureScale;
 CGFloat effectiveScale;
 PixelPointRenderer *renderer;
+FrameExchange<CameraFrame> *cameraFrames;
+FrameLatency presentLatency;
 CGSize imageSize;
 AVCaptureDevice *device;
+std::shared_ptr<const PaletteTable> livePalette;
+std::atomic<bool> livePaletteStale(true);
 
 
 - (void)viewDidLoad {
@@ -55,11 +89,19 @@ AVCaptureDevice *device;
     [_glkView setUserInteractionEnabled:NO];
     
     [EAGLContext setCurrentContext: _glkView.context];
-    renderer = new PixelPointRenderer();
+    // the camera preview never hit tests cells, so it only needs the image as a texture
+    renderer = new PixelPointRenderer(PixelPointRenderer::Mode::Texture);
+    
+    // edits made to the renderer's scene are laid over every new camera frame
+    renderer->scene->enableOverlay();
+    
+    // the capture queue only publishes frames, all GL work stays on the main thread
+    cameraFrames = new FrameExchange<CameraFrame>();
 }
 
 - (IBAction)pixelize:(id)sender {
     shouldPixelize = [(UISwitch *)sender isOn];
+    livePaletteStale = true;
     [[videoDataOutput connectionWithMediaType:AVMediaTypeVideo] setEnabled:shouldPixelize];
     renderer->clear();
     [_glkView setNeedsDisplay];
@@ -430,16 +472,30 @@ AVCaptureDevice *device;
     size_t width = CVPixelBufferGetWidth(imageBuffer);
     size_t height = CVPixelBufferGetHeight(imageBuffer);
     
-    [EAGLContext setCurrentContext: _glkView.context];
-    
     Image scaledImage = Image::scaledFromSource(baseAddress, width, height, 4, bytesPerRow);
-    renderer->loadTexture(scaledImage);
-    
-    imageSize = CGSizeMake(height, width);
 
     // Unlock the pixel buffer
     CVPixelBufferUnlockBaseAddress(imageBuffer,0);
     
+    // fill the frame only this queue owns, then swap it in as the newest one for drawing
+    CameraFrame &frame = cameraFrames->backFrame();
+    frame.scene.load(scaledImage);
+    
+    // only the capture queue touches the palette; building it and its lookup table is the
+    // expensive part, so frames after the first just look their cells up
+    if (LIVE_PALETTE_COLORS)
+    {
+        const size_t cellCount = frame.scene.width * frame.scene.height;
+        if (livePaletteStale.exchange(false))
+        {
+            livePalette = PaletteTable::forPalette(Palette::kMeans(frame.scene.colors.data(), cellCount, Scene::COMPONENTS_PER_CELL, LIVE_PALETTE_COLORS));
+        }
+        Dither::apply(LIVE_DITHER, *livePalette, frame.scene.colors.data(), frame.scene.width, frame.scene.height);
+    }
+    frame.imageSize = CGSizeMake(height, width);
+    frame.captureTime = CMTimeGetSeconds(CMSampleBufferGetPresentationTimeStamp(sampleBuffer));
+    cameraFrames->publish();
+    
     dispatch_async(dispatch_get_main_queue(), ^(void) {
         [_glkView setNeedsDisplay];
     });
@@ -451,8 +507,18 @@ AVCaptureDevice *device;
     
     const CGSize viewSize = CGSizeMake(rect.size.width * [[UIScreen mainScreen] scale], rect.size.height * [[UIScreen mainScreen] scale]);
     
+    // the newest captured frame, if one came in since the last draw. it isn't written to until
+    // the next one is taken
+    const CameraFrame *frame = cameraFrames->takeLatest();
+    
     if (shouldPixelize)
     {
+        if (frame)
+        {
+            renderer->loadTexture(frame->scene);
+            imageSize = frame->imageSize;
+        }
+        
         CGSize viewportSize = imageSize;
         if (imageSize.width > viewSize.width)
         {
@@ -467,6 +533,16 @@ AVCaptureDevice *device;
         
         glViewport((viewSize.width - viewportSize.width) / 2, (viewSize.height - viewportSize.height) / 2, viewportSize.width, viewportSize.height);
         renderer->render();
+        
+        if (frame)
+        {
+            // capture timestamps are on the host clock, like CACurrentMediaTime
+            const double latency = CACurrentMediaTime() - frame->captureTime;
+            presentLatency.frames++;
+            presentLatency.last = latency;
+            presentLatency.total += latency;
+            presentLatency.worst = MAX(presentLatency.worst, latency);
+        }
     }
     else
     {
@@ -7,3 +7,41 @@
 //
 
 #include "Color.h"
+
+#include <algorithm>
+
+static double decode(double value)
+{
+    return value <= 0.04045 ? value / 12.92 : pow((value + 0.055) / 1.055, 2.4);
+}
+
+static double encode(double value)
+{
+    return value <= 0.0031308 ? value * 12.92 : 1.055 * pow(value, 1 / 2.4) - 0.055;
+}
+
+static LinearLight buildTables()
+{
+    LinearLight light;
+    const double scale = (1 << LinearLight::BITS) - 1;
+    for (int i = 0; i < 256; i++)
+    {
+        light.toLinear[i] = (uint16_t)lround(decode(i / 255.0) * scale);
+    }
+    
+    // each entry covers a range of linear values, so it holds the encoding of the middle one
+    const int step = 1 << (LinearLight::BITS - LinearLight::INDEX_BITS);
+    for (int i = 0; i < 1 << LinearLight::INDEX_BITS; i++)
+    {
+        const long value = lround(encode((i + 0.5) * step / scale) * 255);
+        light.fromLinear[i] = (unsigned char)std::min(255L, std::max(0L, value));
+    }
+    
+    return light;
+}
+
+const LinearLight &LinearLight::tables()
+{
+    static const LinearLight light = buildTables();
+    return light;
+}
@@ -10,34 +10,61 @@
 #define Color_hpp
 
 #include <stdio.h>
+#include <stdint.h>
 #include <cmath>
+#include <cstring>
 
-struct Color
+// one packed 8 bit per channel color, laid out r, g, b, a in memory so a run of them reads like
+// an RGBA image and word() can move or compare one as a single 32 bit lane. alpha is opaque
+// unless given; code that only deals in RGB cells (Scene, Quad) ignores it
+struct alignas(4) Color
 {
-    Color (unsigned char *values)
+    explicit Color (const unsigned char *values)
+    : red(values[0]), green(values[1]), blue(values[2]), alpha(255)
     {
-        red = values[0];
-        green = values[1];
-        blue = values[2];
     }
     
-    Color (int red, int green, int blue)
-    : red(red), green(green), blue(blue)
+    Color (unsigned char red, unsigned char green, unsigned char blue, unsigned char alpha = 255)
+    : red(red), green(green), blue(blue), alpha(alpha)
     {
     }
     
     Color ()
+    : red(0), green(0), blue(0), alpha(255)
     {
-        red = 0;
-        blue = 0;
-        green = 0;
     }
     
-    long red;
-    long green;
-    long blue;
+    unsigned char red;
+    unsigned char green;
+    unsigned char blue;
+    unsigned char alpha;
     
-    static Color average(Color a, Color b, Color c, Color d)
+    // the four channels as one word, in host byte order
+    uint32_t word() const
+    {
+        uint32_t value;
+        memcpy(&value, this, sizeof(value));
+        return value;
+    }
+    
+    static Color fromWord(uint32_t value)
+    {
+        Color color;
+        memcpy(static_cast<void *>(&color), &value, sizeof(color));
+        return color;
+    }
+    
+    bool operator==(const Color &other) const
+    {
+        return word() == other.word();
+    }
+    
+    bool operator!=(const Color &other) const
+    {
+        return word() != other.word();
+    }
+    
+    static Color average(const Color &a, const Color &b, const Color &c, const Color &d)
     {
         Color result;
         result.red = sqrt((a.red * a.red + b.red * b.red + c.red * c.red + d.red * d.red) / 4.0);
@@ -48,4 +75,110 @@ struct Color
     }
 };
 
+static_assert(sizeof(Color) == 4, "Color should pack into one 32 bit word");
+
+// sRGB components to linear light and back through tables. linear values are 16 bit fixed point;
+// the way back only looks at their top INDEX_BITS, which keeps every average within one step of
+// the exact conversion and every single value exact
+struct LinearLight
+{
+    static const int BITS = 16;
+    static const int INDEX_BITS = 12;
+    
+    uint16_t toLinear[256];
+    unsigned char fromLinear[1 << INDEX_BITS];
+    
+    // built once, on first use
+    static const LinearLight &tables();
+};
+
+// wide per channel sums for reducing many colors into one, e.g. a block of source pixels into a
+// cell. 64 bits holds the squares of any block an image can have, so nothing is scaled or
+// rounded until the result is taken
+struct ColorAccumulator
+{
+    ColorAccumulator ()
+    : red(0), green(0), blue(0), alpha(0), count(0)
+    {
+    }
+    
+    void add(const unsigned char *values)
+    {
+        red += values[0];
+        green += values[1];
+        blue += values[2];
+        alpha += 255;
+        count++;
+    }
+    
+    void add(const Color &color)
+    {
+        red += color.red;
+        green += color.green;
+        blue += color.blue;
+        alpha += color.alpha;
+        count++;
+    }
+    
+    // for rootMeanSquare. RGB only, the result is opaque
+    void addSquare(const unsigned char *values)
+    {
+        red += values[0] * values[0];
+        green += values[1] * values[1];
+        blue += values[2] * values[2];
+        count++;
+    }
+    
+    // for linearMean. RGB only, the result is opaque
+    void addLinear(const unsigned char *values, const LinearLight &light)
+    {
+        red += light.toLinear[values[0]];
+        green += light.toLinear[values[1]];
+        blue += light.toLinear[values[2]];
+        count++;
+    }
+    
+    // rounded to nearest
+    Color mean() const
+    {
+        if (count == 0)
+        {
+            return Color();
+        }
+        
+        const uint64_t half = count / 2;
+        return Color((red + half) / count, (green + half) / count, (blue + half) / count, (alpha + half) / count);
+    }
+    
+    // the square root of the truncated mean square, which is what pixelation has always used
+    Color rootMeanSquare() const
+    {
+        if (count == 0)
+        {
+            return Color();
+        }
+        
+        return Color(sqrt(red / count), sqrt(green / count), sqrt(blue / count));
+    }
+    
+    // the mean in linear light, back in sRGB
+    Color linearMean(const LinearLight &light) const
+    {
+        if (count == 0)
+        {
+            return Color();
+        }
+        
+        const uint64_t half = count / 2;
+        const int shift = LinearLight::BITS - LinearLight::INDEX_BITS;
+        return Color(light.fromLinear[((red + half) / count) >> shift], light.fromLinear[((green + half) / count) >> shift], light.fromLinear[((blue + half) / count) >> shift]);
+    }
+    
+    uint64_t red;
+    uint64_t green;
+    uint64_t blue;
+    uint64_t alpha;
+    uint64_t count;
+};
+
 #endif /* Color_hpp */
@@ -0,0 +1,234 @@
+//
+//  Dither.cpp
+//  PixelPoint
+//
+//  Created by Kelsey Steeves on 2026-10-19.
+//  Copyright © 2026 Kelsey Steeves. All rights reserved.
+//
+
+#include "Dither.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <vector>
+
+static const int COMPONENTS_PER_CELL = 3;
+
+// the order an 8 x 8 block of cells crosses a rising threshold in
+static const int BAYER_SIZE = 8;
+static const int BAYER[BAYER_SIZE * BAYER_SIZE] =
+{
+     0, 32,  8, 40,  2, 34, 10, 42,
+    48, 16, 56, 24, 50, 18, 58, 26,
+    12, 44,  4, 36, 14, 46,  6, 38,
+    60, 28, 52, 20, 62, 30, 54, 22,
+     3, 35, 11, 43,  1, 33,  9, 41,
+    51, 19, 59, 27, 49, 17, 57, 25,
+    15, 47,  7, 39, 13, 45,  5, 37,
+    63, 31, 55, 23, 61, 29, 53, 21
+};
+
+static int clampComponent(int value)
+{
+    return std::min(255, std::max(0, value));
+}
+
+// the mean distance from each palette color to the nearest other one, which is about how far
+// a cell can be from every color
+static int spacing(const std::vector<Color> &colors)
+{
+    if (colors.size() < 2)
+    {
+        return 0;
+    }
+    
+    double total = 0;
+    for (size_t i = 0; i < colors.size(); i++)
+    {
+        int nearest = INT32_MAX;
+        for (size_t j = 0; j < colors.size(); j++)
+        {
+            const int dr = colors[i].red - colors[j].red, dg = colors[i].green - colors[j].green, db = colors[i].blue - colors[j].blue;
+            const int distance = dr * dr + dg * dg + db * db;
+            nearest = i == j || distance == 0 ? nearest : std::min(nearest, distance);
+        }
+        total += nearest == INT32_MAX ? 0 : sqrt(nearest);
+    }
+    return (int)(total / colors.size() + 0.5);
+}
+
+void Dither::apply(Mode mode, const PaletteTable &table, unsigned char *colors, size_t width, size_t height, size_t threads)
+{
+    const size_t cellCount = width * height;
+    if (table.palette().empty() || cellCount == 0)
+    {
+        return;
+    }
+    
+    if (threads == 0)
+    {
+        threads = cellCount < PARALLEL_CELLS ? 1 : std::max(1u, std::thread::hardware_concurrency());
+    }
+    const size_t threadCount = std::min(height, threads);
+    
+    switch (mode)
+    {
+        case Mode::None:
+        {
+            table.remap(colors, cellCount);
+            break;
+        }
+        case Mode::Ordered:
+        {
+            // thresholds run from just over -spread / 2 to just under spread / 2
+            const int spread = spacing(table.palette().colors());
+            int thresholds[BAYER_SIZE * BAYER_SIZE];
+            for (int i = 0; i < BAYER_SIZE * BAYER_SIZE; i++)
+            {
+                thresholds[i] = (2 * BAYER[i] + 1 - BAYER_SIZE * BAYER_SIZE) * spread / (2 * BAYER_SIZE * BAYER_SIZE);
+            }
+            
+            // the calling thread takes the first share of rows
+            const size_t share = (height + threadCount - 1) / threadCount;
+            std::vector<std::thread> workers;
+            for (size_t first = share; first < height; first += share)
+            {
+                workers.emplace_back(&Dither::ordered, std::cref(table), colors, width, first, std::min(first + share, height), thresholds);
+            }
+            ordered(table, colors, width, 0, std::min(share, height), thresholds);
+            
+            for (std::thread &worker : workers)
+            {
+                worker.join();
+            }
+            break;
+        }
+        case Mode::FloydSteinberg:
+        {
+            static const Tap taps[] = {{1, 0, 7}, {-1, 1, 3}, {0, 1, 5}, {1, 1, 1}};
+            diffuse({taps, sizeof(taps) / sizeof(taps[0]), 4}, table, colors, width, height, threadCount);
+            break;
+        }
+        case Mode::Atkinson:
+        {
+            static const Tap taps[] = {{1, 0, 1}, {2, 0, 1}, {-1, 1, 1}, {0, 1, 1}, {1, 1, 1}, {0, 2, 1}};
+            diffuse({taps, sizeof(taps) / sizeof(taps[0]), 3}, table, colors, width, height, threadCount);
+            break;
+        }
+    }
+}
+
+void Dither::ordered(const PaletteTable &table, unsigned char *colors, size_t width, size_t firstRow, size_t lastRow, const int *thresholds)
+{
+    const std::vector<Color> &entries = table.palette().colors();
+    for (size_t y = firstRow; y < lastRow; y++)
+    {
+        const int *row = thresholds + (y % BAYER_SIZE) * BAYER_SIZE;
+        unsigned char *cell = colors + y * width * COMPONENTS_PER_CELL;
+        for (size_t x = 0; x < width; x++, cell += COMPONENTS_PER_CELL)
+        {
+            const int threshold = row[x % BAYER_SIZE];
+            const Color &color = entries[table.nearest(Color(clampComponent(cell[0] + threshold), clampComponent(cell[1] + threshold), clampComponent(cell[2] + threshold)))];
+            cell[0] = color.red;
+            cell[1] = color.green;
+            cell[2] = color.blue;
+        }
+    }
+}
+
+void Dither::diffuse(const Kernel &kernel, const PaletteTable &table, unsigned char *colors, size_t width, size_t height, size_t threadCount)
+{
+    const std::vector<Color> &entries = table.palette().colors();
+    
+    // cells gather the shares of error owed to them from the cells before them, rather than
+    // having them pushed, so every cell only ever writes its own color and error. rows can then
+    // run side by side, each a few cells behind the row above it, without sharing any writes
+    std::vector<int16_t> errors(width * height * COMPONENTS_PER_CELL);
+    
+    // the furthest a cell in the row above can be ahead of a cell it sends error to
+    long ahead = 0;
+    for (size_t i = 0; i < kernel.count; i++)
+    {
+        if (kernel.taps[i].dy > 0)
+        {
+            ahead = std::max(ahead, (long)-kernel.taps[i].dx);
+        }
+    }
+    
+    // cells finished per row
+    std::unique_ptr<std::atomic<size_t>[]> progress(new std::atomic<size_t>[height]);
+    for (size_t y = 0; y < height; y++)
+    {
+        progress[y].store(0, std::memory_order_relaxed);
+    }
+    
+    auto rows = [&](size_t firstRow, size_t step)
+    {
+        const int rounding = 1 << (kernel.shift - 1);
+        for (size_t y = firstRow; y < height; y += step)
+        {
+            for (size_t start = 0; start < width; start += WAVEFRONT_CHUNK)
+            {
+                const size_t end = std::min(width, start + WAVEFRONT_CHUNK);
+                if (y > 0)
+                {
+                    const size_t needed = std::min(width, end + ahead);
+                    while (progress[y - 1].load(std::memory_order_acquire) < needed)
+                    {
+                        std::this_thread::yield();
+                    }
+                }
+                
+                for (size_t x = start; x < end; x++)
+                {
+                    int owed[COMPONENTS_PER_CELL] = {0, 0, 0};
+                    for (size_t i = 0; i < kernel.count; i++)
+                    {
+                        const Tap &tap = kernel.taps[i];
+                        const long sourceX = (long)x - tap.dx;
+                        if ((size_t)tap.dy > y || sourceX < 0 || sourceX >= (long)width)
+                        {
+                            continue;
+                        }
+                        
+                        const int16_t *error = &errors[((y - tap.dy) * width + sourceX) * COMPONENTS_PER_CELL];
+                        owed[0] += tap.weight * error[0];
+                        owed[1] += tap.weight * error[1];
+                        owed[2] += tap.weight * error[2];
+                    }
+                    
+                    unsigned char *cell = colors + (y * width + x) * COMPONENTS_PER_CELL;
+                    const Color wanted(clampComponent(cell[0] + ((owed[0] + rounding) >> kernel.shift)), clampComponent(cell[1] + ((owed[1] + rounding) >> kernel.shift)), clampComponent(cell[2] + ((owed[2] + rounding) >> kernel.shift)));
+                    const Color &color = entries[table.nearest(wanted)];
+                    
+                    int16_t *error = &errors[(y * width + x) * COMPONENTS_PER_CELL];
+                    error[0] = wanted.red - color.red;
+                    error[1] = wanted.green - color.green;
+                    error[2] = wanted.blue - color.blue;
+                    cell[0] = color.red;
+                    cell[1] = color.green;
+                    cell[2] = color.blue;
+                }
+                
+                progress[y].store(end, std::memory_order_release);
+            }
+        }
+    };
+    
+    // rows are dealt out in turn, the calling thread taking the first
+    std::vector<std::thread> workers;
+    for (size_t i = 1; i < threadCount; i++)
+    {
+        workers.emplace_back(rows, i, threadCount);
+    }
+    rows(0, threadCount);
+    
+    for (std::thread &worker : workers)
+    {
+        worker.join();
+    }
+}
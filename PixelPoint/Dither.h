@@ -0,0 +1,68 @@
+//
+//  Dither.hpp
+//  PixelPoint
+//
+//  Created by Kelsey Steeves on 2026-10-19.
+//  Copyright © 2026 Kelsey Steeves. All rights reserved.
+//
+
+#ifndef Dither_hpp
+#define Dither_hpp
+
+#include "PaletteTable.h"
+
+#include <cstddef>
+
+// reduces a row order RGB grid to a palette while spreading the difference around, so areas
+// between palette colors come out as a mix of them rather than a band of the nearest one
+class Dither
+{
+public:
+    enum class Mode
+    {
+        // every cell is its nearest color
+        None,
+        
+        // an 8 x 8 Bayer threshold, scaled to the palette's spacing, is added to every cell.
+        // cells don't depend on each other, so there are no passes or branches to speak of
+        Ordered,
+        
+        // each cell's error is shared out to the cells after it (Floyd-Steinberg passes all of
+        // it on, Atkinson three quarters, which keeps more contrast). a cell only waits on cells
+        // up to one column ahead in the row above, so large grids run rows on several threads
+        // in a staggered wavefront
+        FloydSteinberg,
+        Atkinson
+    };
+    
+    // threads is how many to split rows across; 0 uses one per CPU once a grid has
+    // PARALLEL_CELLS cells, and 1 keeps to the calling thread
+    static void apply(Mode mode, const PaletteTable &table, unsigned char *colors, size_t width, size_t height, size_t threads = 0);
+    
+private:
+    // a share of a cell's error, weight / (1 << shift), going dx, dy from it
+    struct Tap
+    {
+        int dx;
+        int dy;
+        int weight;
+    };
+    
+    struct Kernel
+    {
+        const Tap *taps;
+        size_t count;
+        int shift;
+    };
+    
+    // rows or wavefronts are split across threads from this many cells up
+    static const size_t PARALLEL_CELLS = 1 << 16;
+    
+    // cells a row is finished in before the rows after it hear of it
+    static const size_t WAVEFRONT_CHUNK = 32;
+    
+    static void ordered(const PaletteTable &table, unsigned char *colors, size_t width, size_t firstRow, size_t lastRow, const int *thresholds);
+    static void diffuse(const Kernel &kernel, const PaletteTable &table, unsigned char *colors, size_t width, size_t height, size_t threadCount);
+};
+
+#endif /* Dither_hpp */
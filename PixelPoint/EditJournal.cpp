@@ -0,0 +1,251 @@
+//
+//  EditJournal.cpp
+//  PixelPoint
+//
+//  Created by Kelsey Steeves on 2026-10-19.
+//  Copyright © 2026 Kelsey Steeves. All rights reserved.
+//
+
+#include "EditJournal.h"
+
+#include "Scene.h"
+
+#include <algorithm>
+#include <cstring>
+
+static const int COMPONENTS_PER_CELL = Scene::COMPONENTS_PER_CELL;
+
+EditJournal::EditJournal(const Scene &scene, const Limits &limits)
+: limits(limits), position(0), totalBytes(0), lastCommit(0.0), mergeable(false)
+{
+    reset(scene);
+}
+
+void EditJournal::reset(const Scene &scene)
+{
+    committed = scene.colors;
+    entries.clear();
+    pending.clear();
+    position = 0;
+    totalBytes = 0;
+    mergeable = false;
+}
+
+void EditJournal::touched(size_t first, size_t last)
+{
+    // strokes and row by row fills mostly continue the last range
+    if (!pending.empty())
+    {
+        std::pair<size_t, size_t> &previous = pending.back();
+        if (first <= previous.second + 1 && last + 1 >= previous.first)
+        {
+            previous.first = std::min(previous.first, first);
+            previous.second = std::max(previous.second, last);
+            return;
+        }
+    }
+    
+    pending.push_back(std::make_pair(first, last));
+}
+
+void EditJournal::encode(const unsigned char *colors, size_t count, std::vector<ColorRun> &runs)
+{
+    const unsigned char *end = colors + count * COMPONENTS_PER_CELL;
+    while (colors < end)
+    {
+        ColorRun run = {1, {colors[0], colors[1], colors[2]}};
+        colors += COMPONENTS_PER_CELL;
+        while (colors < end && colors[0] == run.rgb[0] && colors[1] == run.rgb[1] && colors[2] == run.rgb[2])
+        {
+            run.length++;
+            colors += COMPONENTS_PER_CELL;
+        }
+        runs.push_back(run);
+    }
+}
+
+size_t EditJournal::Entry::bytes() const
+{
+    return sizeof(Entry) + spans.size() * sizeof(Span) + (before.size() + after.size()) * sizeof(ColorRun);
+}
+
+void EditJournal::commit(Scene &scene, double time)
+{
+    record(scene, time, true);
+}
+
+void EditJournal::record(Scene &scene, double time, bool allowMerge)
+{
+    if (pending.empty())
+    {
+        return;
+    }
+    
+    Entry entry;
+    const size_t cellCount = std::min(scene.colors.size(), committed.size()) / COMPONENTS_PER_CELL;
+    const unsigned char *current = scene.colors.data();
+    
+    // compare each edited range with the last committed colors and bring those up to date as
+    // it goes, so cells in overlapping ranges are only recorded once
+    for (const std::pair<size_t, size_t> &range : pending)
+    {
+        const size_t last = std::min(range.second + 1, cellCount);
+        size_t cell = range.first;
+        while (cell < last)
+        {
+            if (memcmp(&current[cell * COMPONENTS_PER_CELL], &committed[cell * COMPONENTS_PER_CELL], COMPONENTS_PER_CELL) == 0)
+            {
+                cell++;
+                continue;
+            }
+            
+            const size_t first = cell;
+            while (cell < last && memcmp(&current[cell * COMPONENTS_PER_CELL], &committed[cell * COMPONENTS_PER_CELL], COMPONENTS_PER_CELL) != 0)
+            {
+                cell++;
+            }
+            
+            const size_t count = cell - first;
+            const size_t beforeRuns = entry.before.size();
+            const size_t afterRuns = entry.after.size();
+            encode(&committed[first * COMPONENTS_PER_CELL], count, entry.before);
+            encode(&current[first * COMPONENTS_PER_CELL], count, entry.after);
+            entry.spans.push_back({(uint32_t)first, (uint32_t)count, (uint32_t)(entry.before.size() - beforeRuns), (uint32_t)(entry.after.size() - afterRuns)});
+            
+            memcpy(&committed[first * COMPONENTS_PER_CELL], &current[first * COMPONENTS_PER_CELL], count * COMPONENTS_PER_CELL);
+        }
+    }
+    pending.clear();
+    
+    if (entry.spans.empty())
+    {
+        return;
+    }
+    
+    const bool merge = allowMerge && mergeable && position == entries.size() && !entries.empty() &&
+        limits.mergeInterval > 0.0 && time - lastCommit <= limits.mergeInterval;
+    
+    // redo history ends with a new edit
+    for (size_t i = position; i < entries.size(); i++)
+    {
+        totalBytes -= entries[i].bytes();
+    }
+    entries.resize(position);
+    
+    if (merge)
+    {
+        // spans apply in order, so the merged entry replays this operation after the earlier ones
+        Entry &previous = entries.back();
+        totalBytes -= previous.bytes();
+        previous.spans.insert(previous.spans.end(), entry.spans.begin(), entry.spans.end());
+        previous.before.insert(previous.before.end(), entry.before.begin(), entry.before.end());
+        previous.after.insert(previous.after.end(), entry.after.begin(), entry.after.end());
+        totalBytes += previous.bytes();
+    }
+    else
+    {
+        totalBytes += entry.bytes();
+        entries.push_back(std::move(entry));
+    }
+    position = entries.size();
+    lastCommit = time;
+    mergeable = true;
+    
+    size_t dropped = 0;
+    while (bytes() > limits.maxBytes && entries.size() - dropped > 1)
+    {
+        totalBytes -= entries[dropped].bytes();
+        dropped++;
+    }
+    entries.erase(entries.begin(), entries.begin() + dropped);
+    position -= dropped;
+}
+
+void EditJournal::apply(Scene &scene, const Entry &entry, bool forward)
+{
+    const size_t cellCount = std::min(scene.colors.size(), committed.size()) / COMPONENTS_PER_CELL;
+    const std::vector<ColorRun> &runs = forward ? entry.after : entry.before;
+    
+    // undo walks the spans backwards so cells changed twice end up with their oldest color
+    size_t runIndex = forward ? 0 : runs.size();
+    for (size_t s = 0; s < entry.spans.size(); s++)
+    {
+        const Span &span = entry.spans[forward ? s : entry.spans.size() - 1 - s];
+        const size_t spanRuns = forward ? span.afterRuns : span.beforeRuns;
+        if (!forward)
+        {
+            runIndex -= spanRuns;
+        }
+        
+        if (span.first + span.count <= cellCount)
+        {
+            unsigned char *cell = &scene.colors[span.first * COMPONENTS_PER_CELL];
+            for (size_t r = runIndex; r < runIndex + spanRuns; r++)
+            {
+                for (uint32_t i = 0; i < runs[r].length; i++, cell += COMPONENTS_PER_CELL)
+                {
+                    cell[0] = runs[r].rgb[0];
+                    cell[1] = runs[r].rgb[1];
+                    cell[2] = runs[r].rgb[2];
+                }
+            }
+            
+            memcpy(&committed[span.first * COMPONENTS_PER_CELL], &scene.colors[span.first * COMPONENTS_PER_CELL], span.count * COMPONENTS_PER_CELL);
+            scene.markEdited(span.first, span.first + span.count - 1);
+            scene.keepInOverlay(span.first, span.first + span.count - 1);
+        }
+        
+        if (forward)
+        {
+            runIndex += spanRuns;
+        }
+    }
+}
+
+bool EditJournal::canUndo() const
+{
+    return position > 0 || !pending.empty();
+}
+
+bool EditJournal::canRedo() const
+{
+    return position < entries.size() && pending.empty();
+}
+
+bool EditJournal::undo(Scene &scene)
+{
+    // edits right before an undo are undone on their own, not merged into the entry before
+    record(scene, lastCommit, false);
+    if (position == 0)
+    {
+        return false;
+    }
+    
+    position--;
+    apply(scene, entries[position], false);
+    mergeable = false;
+    return true;
+}
+
+bool EditJournal::redo(Scene &scene)
+{
+    if (!canRedo())
+    {
+        return false;
+    }
+    
+    apply(scene, entries[position], true);
+    position++;
+    mergeable = false;
+    return true;
+}
+
+size_t EditJournal::entryCount() const
+{
+    return entries.size();
+}
+
+size_t EditJournal::bytes() const
+{
+    return totalBytes + committed.size();
+}
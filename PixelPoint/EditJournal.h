@@ -0,0 +1,108 @@
+//
+//  EditJournal.hpp
+//  PixelPoint
+//
+//  Created by Kelsey Steeves on 2026-10-19.
+//  Copyright © 2026 Kelsey Steeves. All rights reserved.
+//
+
+#ifndef EditJournal_hpp
+#define EditJournal_hpp
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+struct Scene;
+
+// undo and redo for a scene's edits. rather than snapshotting the grid per operation, it keeps
+// one copy of the colors as of the last commit and, on commit, compares only the cells edited
+// since. each entry stores the spans of cells that actually changed, with their colors before
+// and after run length encoded, so a fill costs a few runs however big it is. undo and redo
+// write the cells back through the scene, so they go up in the renderer's batched edit uploads
+// (and into its overlay) without being recorded again
+class EditJournal
+{
+public:
+    struct Limits
+    {
+        // the oldest entries are dropped once the history, plus the copy of the grid it
+        // compares against, is bigger than this. the newest entry is always kept
+        size_t maxBytes;
+        
+        // an operation committed within this many seconds of the previous one joins its
+        // entry, so quick consecutive strokes undo together. 0 never merges
+        double mergeInterval;
+    };
+    
+    EditJournal(const Scene &scene, const Limits &limits);
+    
+    // forgets the history and takes the scene's current colors as the starting point
+    void reset(const Scene &scene);
+    
+    // records everything edited since the last commit as one operation, at a time in seconds
+    void commit(Scene &scene, double time);
+    
+    bool canUndo() const;
+    bool canRedo() const;
+    
+    // uncommitted edits are committed first, so they are the first thing undone
+    bool undo(Scene &scene);
+    bool redo(Scene &scene);
+    
+    // scene edits report the cells they wrote here
+    void touched(size_t first, size_t last);
+    
+    size_t entryCount() const;
+    
+    // the entries and the committed copy of the grid
+    size_t bytes() const;
+    
+    Limits limits;
+    
+private:
+    struct ColorRun
+    {
+        uint32_t length;
+        unsigned char rgb[3];
+    };
+    
+    // consecutive changed cells and how many color runs each side of them takes
+    struct Span
+    {
+        uint32_t first;
+        uint32_t count;
+        uint32_t beforeRuns;
+        uint32_t afterRuns;
+    };
+    
+    struct Entry
+    {
+        std::vector<Span> spans;
+        std::vector<ColorRun> before;
+        std::vector<ColorRun> after;
+        
+        size_t bytes() const;
+    };
+    
+    static void encode(const unsigned char *colors, size_t count, std::vector<ColorRun> &runs);
+    void record(Scene &scene, double time, bool allowMerge);
+    void apply(Scene &scene, const Entry &entry, bool forward);
+    
+    // colors as of the last commit, or undo/redo
+    std::vector<unsigned char> committed;
+    std::vector<Entry> entries;
+    
+    // entries before this are done, the rest can be redone
+    size_t position;
+    size_t totalBytes;
+    double lastCommit;
+    
+    // only an entry that was just committed, not undone or redone since, takes merges
+    bool mergeable;
+    
+    // cell ranges written since the last commit, may overlap
+    std::vector<std::pair<size_t, size_t>> pending;
+};
+
+#endif /* EditJournal_hpp */
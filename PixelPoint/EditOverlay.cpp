@@ -0,0 +1,202 @@
+//
+//  EditOverlay.cpp
+//  PixelPoint
+//
+//  Created by Kelsey Steeves on 2026-10-19.
+//  Copyright © 2026 Kelsey Steeves. All rights reserved.
+//
+
+#include "EditOverlay.h"
+
+static const int COMPONENTS_PER_CELL = 3;
+
+static uint32_t pack(const unsigned char *rgb)
+{
+    return (uint32_t)rgb[0] << 16 | (uint32_t)rgb[1] << 8 | rgb[2];
+}
+
+static void unpack(uint32_t rgb, unsigned char *out)
+{
+    out[0] = rgb >> 16;
+    out[1] = rgb >> 8;
+    out[2] = rgb;
+}
+
+EditOverlay::EditOverlay()
+: dense(false), tooManyColors(false), width(0), height(0), count(0)
+{
+}
+
+void EditOverlay::record(const unsigned char *colors, size_t width, size_t height, size_t first, size_t last)
+{
+    // a dense overlay only covers the grid it was made for
+    if (dense && (width != this->width || height != this->height))
+    {
+        makeSparse();
+    }
+    
+    const unsigned char *rgb = colors + first * COMPONENTS_PER_CELL;
+    for (size_t cell = first; cell <= last; cell++, rgb += COMPONENTS_PER_CELL)
+    {
+        if (dense && setDense(cell, pack(rgb)))
+        {
+            continue;
+        }
+        
+        if (dense)
+        {
+            // out of palette colors
+            makeSparse();
+            tooManyColors = true;
+        }
+        
+        const uint64_t key = (uint64_t)(cell / width) << 32 | (cell % width);
+        sparse[key] = pack(rgb);
+        
+        if (!tooManyColors && sparse.size() > width * height / DENSE_DIVISOR)
+        {
+            makeDense(width, height);
+        }
+    }
+}
+
+bool EditOverlay::setDense(size_t cell, uint32_t rgb)
+{
+    std::unordered_map<uint32_t, uint8_t>::const_iterator found = paletteIndex.find(rgb);
+    if (found == paletteIndex.end())
+    {
+        if (palette.size() == MAX_PALETTE)
+        {
+            return false;
+        }
+        
+        found = paletteIndex.insert(std::make_pair(rgb, (uint8_t)palette.size())).first;
+        palette.push_back(rgb);
+    }
+    
+    const uint64_t bit = (uint64_t)1 << (cell % 64);
+    if (!(bits[cell / 64] & bit))
+    {
+        bits[cell / 64] |= bit;
+        count++;
+    }
+    indices[cell] = found->second;
+    return true;
+}
+
+void EditOverlay::makeDense(size_t width, size_t height)
+{
+    this->width = width;
+    this->height = height;
+    count = 0;
+    bits.assign((width * height + 63) / 64, 0);
+    indices.assign(width * height, 0);
+    palette.clear();
+    paletteIndex.clear();
+    dense = true;
+    
+    // edits outside this grid are dropped, they could never be composited over it
+    for (const std::pair<const uint64_t, uint32_t> &edit : sparse)
+    {
+        const size_t x = edit.first & 0xffffffff;
+        const size_t y = edit.first >> 32;
+        if (x < width && y < height && !setDense(y * width + x, edit.second))
+        {
+            // too many colors to go dense
+            bits.clear();
+            indices.clear();
+            palette.clear();
+            paletteIndex.clear();
+            dense = false;
+            tooManyColors = true;
+            return;
+        }
+    }
+    
+    sparse.clear();
+}
+
+void EditOverlay::makeSparse()
+{
+    sparse.clear();
+    for (size_t word = 0; word < bits.size(); word++)
+    {
+        for (uint64_t set = bits[word]; set; set &= set - 1)
+        {
+            const size_t cell = word * 64 + __builtin_ctzll(set);
+            sparse[(uint64_t)(cell / width) << 32 | (cell % width)] = palette[indices[cell]];
+        }
+    }
+    
+    bits.clear();
+    indices.clear();
+    palette.clear();
+    paletteIndex.clear();
+    count = 0;
+    dense = false;
+}
+
+void EditOverlay::clear()
+{
+    sparse.clear();
+    bits.clear();
+    indices.clear();
+    palette.clear();
+    paletteIndex.clear();
+    count = 0;
+    dense = false;
+    tooManyColors = false;
+}
+
+void EditOverlay::composite(unsigned char *colors, size_t width, size_t height) const
+{
+    if (!dense)
+    {
+        for (const std::pair<const uint64_t, uint32_t> &edit : sparse)
+        {
+            const size_t x = edit.first & 0xffffffff;
+            const size_t y = edit.first >> 32;
+            if (x < width && y < height)
+            {
+                unpack(edit.second, colors + (y * width + x) * COMPONENTS_PER_CELL);
+            }
+        }
+        return;
+    }
+    
+    const bool sameGrid = width == this->width && height == this->height;
+    for (size_t word = 0; word < bits.size(); word++)
+    {
+        for (uint64_t set = bits[word]; set; set &= set - 1)
+        {
+            const size_t cell = word * 64 + __builtin_ctzll(set);
+            if (sameGrid)
+            {
+                unpack(palette[indices[cell]], colors + cell * COMPONENTS_PER_CELL);
+                continue;
+            }
+            
+            const size_t x = cell % this->width;
+            const size_t y = cell / this->width;
+            if (x < width && y < height)
+            {
+                unpack(palette[indices[cell]], colors + (y * width + x) * COMPONENTS_PER_CELL);
+            }
+        }
+    }
+}
+
+size_t EditOverlay::size() const
+{
+    return dense ? count : sparse.size();
+}
+
+bool EditOverlay::empty() const
+{
+    return size() == 0;
+}
+
+bool EditOverlay::isDense() const
+{
+    return dense;
+}
@@ -0,0 +1,66 @@
+//
+//  EditOverlay.hpp
+//  PixelPoint
+//
+//  Created by Kelsey Steeves on 2026-10-19.
+//  Copyright © 2026 Kelsey Steeves. All rights reserved.
+//
+
+#ifndef EditOverlay_hpp
+#define EditOverlay_hpp
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+// cell edits kept apart from the pixelated image, so they can be laid back over every new one.
+// edits are stored by x and y, sparsely while there are few. once they cover enough of the grid
+// (and use at most 256 colors) they switch to a bit per cell and a palette index per cell, which
+// is smaller and walks in row order. either way compositing costs the edited cells, plus a word
+// per 64 cells when dense, not a pass over the grid
+class EditOverlay
+{
+public:
+    EditOverlay();
+    
+    // keeps cells first to last of a row order RGB grid as edits
+    void record(const unsigned char *colors, size_t width, size_t height, size_t first, size_t last);
+    void clear();
+    
+    // writes the edits over a row order RGB grid, skipping any outside it
+    void composite(unsigned char *colors, size_t width, size_t height) const;
+    
+    size_t size() const;
+    bool empty() const;
+    bool isDense() const;
+    
+private:
+    static const size_t MAX_PALETTE = 256;
+    
+    // dense once the edits cover this fraction of the grid
+    static const size_t DENSE_DIVISOR = 16;
+    
+    void makeDense(size_t width, size_t height);
+    void makeSparse();
+    bool setDense(size_t cell, uint32_t rgb);
+    
+    // packed RGB by y << 32 | x
+    std::unordered_map<uint64_t, uint32_t> sparse;
+    
+    // a width x height grid of bits, and the palette index of every set cell
+    bool dense;
+    
+    // set once the edits use too many colors to go dense, until cleared
+    bool tooManyColors;
+    
+    size_t width;
+    size_t height;
+    size_t count;
+    std::vector<uint64_t> bits;
+    std::vector<uint8_t> indices;
+    std::vector<uint32_t> palette;
+    std::unordered_map<uint32_t, uint8_t> paletteIndex;
+};
+
+#endif /* EditOverlay_hpp */
@@ -0,0 +1,93 @@
+//
+//  FrameExchange.hpp
+//  PixelPoint
+//
+//  Created by Kelsey Steeves on 2026-10-19.
+//  Copyright © 2026 Kelsey Steeves. All rights reserved.
+//
+
+#ifndef FrameExchange_hpp
+#define FrameExchange_hpp
+
+#include <atomic>
+#include <cstddef>
+
+// hands frames from one producer thread to one consumer thread without locks or copies. there
+// are three frames: the producer fills the back one, the consumer reads the front one, and
+// publishing swaps the back frame with the middle one. the consumer swaps the middle frame in
+// only when it has been published since it last looked, so it always gets the newest finished
+// frame. neither side ever waits, and a frame is never written while it is being read. frames
+// are reused, so payloads that keep their storage (like Scene) stop allocating once warm
+template <typename Frame>
+class FrameExchange
+{
+public:
+    FrameExchange()
+    : published(0), taken(0), dropped(0), back(0), middle(1), front(2)
+    {
+        
+    }
+    
+    FrameExchange(const FrameExchange &) = delete;
+    FrameExchange &operator=(const FrameExchange &) = delete;
+    
+    // producer: the frame to fill next. it stays the producer's until publish
+    Frame &backFrame()
+    {
+        return frames[back];
+    }
+    
+    // producer: makes the back frame the newest one. if the consumer never took the frame it
+    // replaces, that one was dropped
+    void publish()
+    {
+        const int previous = middle.exchange(back | FRESH, std::memory_order_acq_rel);
+        back = previous & INDEX;
+        
+        published.fetch_add(1, std::memory_order_relaxed);
+        if (previous & FRESH)
+        {
+            dropped.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+    
+    // consumer: the newest frame published since the last call, or null if there is none. the
+    // frame stays valid and untouched until the next call
+    const Frame *takeLatest()
+    {
+        if (!(middle.load(std::memory_order_relaxed) & FRESH))
+        {
+            return nullptr;
+        }
+        
+        front = middle.exchange(front, std::memory_order_acq_rel) & INDEX;
+        
+        taken.fetch_add(1, std::memory_order_relaxed);
+        return &frames[front];
+    }
+    
+    // consumer: whether takeLatest would return a frame
+    bool hasNewFrame() const
+    {
+        return middle.load(std::memory_order_relaxed) & FRESH;
+    }
+    
+    // readable from either thread
+    std::atomic<size_t> published;
+    std::atomic<size_t> taken;
+    std::atomic<size_t> dropped;
+    
+private:
+    static const int INDEX = 3;
+    static const int FRESH = 4;
+    
+    Frame frames[3];
+    
+    // back is only touched by the producer and front only by the consumer. middle holds the
+    // index of the frame in between, and whether it was published since the consumer last took one
+    int back;
+    std::atomic<int> middle;
+    int front;
+};
+
+#endif /* FrameExchange_hpp */
@@ -12,15 +12,31 @@
 
 #if !defined (IOS)
 #include "SOIL.h"
+#include "stb_image_aug.h"
 #endif
 
 #include <algorithm>
 
-// we always use RGB
+// we always use RGB, apart from grayscale images which are luminance only
 static const int CHANNELS = 3;
+static const int LUMINANCE_CHANNELS = 1;
 static const int TARGET_SMALL_DIMENSION = 22;
 static const int TARGET_LARGE_DIMENSION = 28;
 
+// number of times the image is halved to reach the target grid size
+static int divisionsForSize(size_t width, size_t height)
+{
+    int numDivisions = 0;
+    while (std::max(width, height) / 2 >= TARGET_LARGE_DIMENSION && std::min(width, height) / 2 >= TARGET_SMALL_DIMENSION)
+    {
+        width /= 2;
+        height /= 2;
+        numDivisions++;
+    }
+    
+    return numDivisions;
+}
+
 #if !defined(IOS)
 Image Image::loadImage(const char *filePath)
 {
@@ -29,55 +45,191 @@ Image Image::loadImage(const char *filePath)
     
     return Image(std::unique_ptr<unsigned char, decltype(&std::free)>(image, &std::free), imageWidth, imageHeight, CHANNELS);
 }
+
+// the chroma terms of the JFIF conversion (same coefficients as stb_image's YCbCr_to_RGB_row) in
+// 16 bit fixed point, rounding included
+struct ChromaTables
+{
+    int32_t red[256];
+    int32_t greenFromCb[256];
+    int32_t greenFromCr[256];
+    int32_t blue[256];
+    
+    static const ChromaTables &tables()
+    {
+        static const ChromaTables tables = []
+        {
+            ChromaTables built;
+            for (int i = 0; i < 256; i++)
+            {
+                built.red[i] = (int32_t)std::lround(1.40200 * (i - 128) * 65536) + 32768;
+                built.greenFromCb[i] = (int32_t)std::lround(-0.34414 * (i - 128) * 65536) + 32768;
+                built.greenFromCr[i] = (int32_t)std::lround(-0.71414 * (i - 128) * 65536);
+                built.blue[i] = (int32_t)std::lround(1.77200 * (i - 128) * 65536) + 32768;
+            }
+            return built;
+        }();
+        return tables;
+    }
+};
+
+// both averagings have to be taken over RGB (squares or linear light of the YCbCr means aren't the
+// means of the squares or linear light), so each luma sample is paired with the chroma samples it
+// sits in and converted on the way through; still no upsampled image is built
+template <Image::Averaging averaging>
+static ColorAccumulator sumPlanes(const stbi_jpeg_planes &planes, size_t left, size_t top, size_t right, size_t bottom, const LinearLight &light, const ChromaTables &chroma)
+{
+    right = std::min(right, (size_t)planes.w[0]);
+    bottom = std::min(bottom, (size_t)planes.h[0]);
+    
+    auto clamp = [](int32_t value) { return (unsigned char)std::min(255, std::max(0, value >> 16)); };
+    ColorAccumulator sum;
+    for (size_t y = top; y < bottom; y++)
+    {
+        const unsigned char *luma = planes.data[0] + y * planes.stride[0];
+        const unsigned char *cb = planes.data[1] + std::min(y / planes.vs[1], (size_t)planes.h[1] - 1) * planes.stride[1];
+        const unsigned char *cr = planes.data[2] + std::min(y / planes.vs[2], (size_t)planes.h[2] - 1) * planes.stride[2];
+        for (size_t x = left; x < right; x++)
+        {
+            const int32_t scaledLuma = luma[x] << 16;
+            const unsigned char u = cb[std::min(x / planes.hs[1], (size_t)planes.w[1] - 1)];
+            const unsigned char v = cr[std::min(x / planes.hs[2], (size_t)planes.w[2] - 1)];
+            const unsigned char values[] = {clamp(scaledLuma + chroma.red[v]), clamp(scaledLuma + chroma.greenFromCb[u] + chroma.greenFromCr[v]), clamp(scaledLuma + chroma.blue[u])};
+            if (averaging == Image::Averaging::Linear)
+            {
+                sum.addLinear(values, light);
+            }
+            else
+            {
+                sum.addSquare(values);
+            }
+        }
+    }
+    return sum;
+}
+
+// picks the kernel from the decoded channel count: 1 and 2 (luminance, alpha) only average luminance
+static Image scaledFromFile(const char *filePath, bool grayscale, Image::Averaging averaging)
+{
+    int imageWidth = 0, imageHeight = 0, resultChannels = 0;
+    unsigned char *image = SOIL_load_image(filePath, &imageWidth, &imageHeight, &resultChannels, grayscale ? SOIL_LOAD_L : SOIL_LOAD_AUTO);
+    if (grayscale)
+    {
+        resultChannels = LUMINANCE_CHANNELS;
+    }
+    
+    std::unique_ptr<unsigned char, decltype(&std::free)> data(image, &std::free);
+    const size_t stride = (size_t)imageWidth * resultChannels;
+    if (resultChannels <= 2)
+    {
+        return Image::scaledFromLuminance(image, imageWidth, imageHeight, resultChannels, stride, averaging);
+    }
+    
+    return Image::scaledFromSource(image, imageWidth, imageHeight, resultChannels, stride, averaging);
+}
+
+Image Image::loadScaledImage(const char *filePath, bool grayscale, Averaging averaging)
+{
+    stbi_jpeg_planes planes;
+    if (!stbi_jpeg_load_planes(filePath, &planes))
+    {
+        // not a JPEG, or not one stb can decode or split into whole-sample planes; go through SOIL
+        return scaledFromFile(filePath, grayscale, averaging);
+    }
+    
+    if (grayscale || planes.n == 1)
+    {
+        // the Y plane is the luminance image, chroma is never looked at
+        Image result = scaledFromLuminance(planes.data[0], planes.x, planes.y, LUMINANCE_CHANNELS, planes.stride[0], averaging);
+        stbi_jpeg_free_planes(&planes);
+        return result;
+    }
+    
+    const int numDivisions = divisionsForSize(planes.x, planes.y);
+    const size_t sizeToAverage = (size_t)1 << numDivisions;
+    const size_t resultWidth = (size_t)planes.x >> numDivisions;
+    const size_t resultHeight = (size_t)planes.y >> numDivisions;
+    unsigned char *resultImage = (unsigned char *)malloc(resultWidth * resultHeight * CHANNELS * sizeof(unsigned char));
+    const LinearLight &light = LinearLight::tables();
+    const ChromaTables &chroma = ChromaTables::tables();
+    
+    for (size_t j = 0; j < resultHeight; j++)
+    {
+        for (size_t i = 0; i < resultWidth; i++)
+        {
+            const size_t left = i * sizeToAverage, right = left + sizeToAverage;
+            const size_t top = j * sizeToAverage, bottom = top + sizeToAverage;
+            const Color average = averaging == Averaging::Linear ? sumPlanes<Averaging::Linear>(planes, left, top, right, bottom, light, chroma).linearMean(light) : sumPlanes<Averaging::RootMeanSquare>(planes, left, top, right, bottom, light, chroma).rootMeanSquare();
+            
+            long targetPosition = (j * resultWidth + i) * CHANNELS;
+            resultImage[targetPosition] = average.red;
+            resultImage[targetPosition + 1] = average.green;
+            resultImage[targetPosition + 2] = average.blue;
+        }
+    }
+    
+    stbi_jpeg_free_planes(&planes);
+    
+    return Image(std::unique_ptr<unsigned char, decltype(&std::free)>(resultImage, &std::free), resultWidth, resultHeight, CHANNELS);
+}
 #endif
 
-Image Image::scaledFromSource(const Image &original)
+Image Image::scaledFromSource(const Image &original, Averaging averaging)
 {
     size_t imageWidth = original.width;
     size_t imageHeight = original.height;
     unsigned char *image = original.data.get();
     
-    return scaledFromSource(image, imageWidth, imageHeight, CHANNELS, imageWidth * CHANNELS);
+    if (original.channels == LUMINANCE_CHANNELS)
+    {
+        return scaledFromLuminance(image, imageWidth, imageHeight, LUMINANCE_CHANNELS, imageWidth, averaging);
+    }
+    
+    return scaledFromSource(image, imageWidth, imageHeight, CHANNELS, imageWidth * CHANNELS, averaging);
 }
 
-Image Image::scaledFromSourceHelper(unsigned char *image, size_t width, size_t height, int channels, int outChannels, size_t stride, bool scaleUp)
+// sums a block of pixels, squared or in linear light, walking its rows in memory order
+template <Image::Averaging averaging>
+static ColorAccumulator sumBlock(const unsigned char *block, size_t stride, long size, int channels, const LinearLight &light)
 {
-    // process the image
-    size_t calculatedWidth = width, calculatedHeight = height;
-    int numDivisions = 0;
-    while (std::max(calculatedWidth, calculatedHeight) / 2 >= TARGET_LARGE_DIMENSION && std::min(calculatedWidth, calculatedHeight) / 2 >= TARGET_SMALL_DIMENSION)
+    ColorAccumulator sum;
+    for (long y = 0; y < size; y++)
     {
-        calculatedWidth /= 2;
-        calculatedHeight /= 2;
-        numDivisions++;
+        const unsigned char *row = block + y * stride;
+        for (long x = 0; x < size; x++)
+        {
+            if (averaging == Image::Averaging::Linear)
+            {
+                sum.addLinear(row + x * channels, light);
+            }
+            else
+            {
+                sum.addSquare(row + x * channels);
+            }
+        }
     }
+    return sum;
+}
+
+Image Image::scaledFromSourceHelper(unsigned char *image, size_t width, size_t height, int channels, int outChannels, size_t stride, bool scaleUp, Averaging averaging)
+{
+    // process the image
+    const int numDivisions = divisionsForSize(width, height);
+    size_t calculatedWidth = width >> numDivisions, calculatedHeight = height >> numDivisions;
     
     const long sizeToAverage = 1 << numDivisions;
     const long resultSize = (long)calculatedWidth * (long)calculatedHeight * outChannels * (scaleUp ? sizeToAverage * sizeToAverage : 1);
     unsigned char *resultImage = (unsigned char *)malloc(resultSize * sizeof(unsigned char));
     const size_t resultWidth = calculatedWidth;
     const size_t resultHeight = calculatedHeight;
+    const LinearLight &light = LinearLight::tables();
     
-    for (int i = 0; i < resultWidth; i++)
+    for (size_t j = 0; j < resultHeight; j++)
     {
-        for (int j = 0; j < resultHeight; j++)
+        for (size_t i = 0; i < resultWidth; i++)
         {
-            // sum the squares of each component
-            long long redSum = 0, greenSum = 0, blueSum = 0;
-            for (long x = 0; x < sizeToAverage; x++)
-            {
-                for (long y = 0; y < sizeToAverage; y++)
-                {
-                    long innerPos = (j * sizeToAverage + y) * stride + ((i * sizeToAverage) + x) * channels;
-                    redSum += image[innerPos] * image[innerPos];
-                    greenSum += image[innerPos + 1] * image[innerPos + 1];
-                    blueSum += image[innerPos + 2] * image[innerPos + 2];
-                }
-            }
-            
-            // take sqrt of averages
-            int avgBase = sizeToAverage * sizeToAverage;
-            Color average(sqrt(redSum / avgBase), sqrt(greenSum / avgBase), sqrt(blueSum / avgBase));
+            const unsigned char *block = image + j * sizeToAverage * stride + i * sizeToAverage * channels;
+            const Color average = averaging == Averaging::Linear ? sumBlock<Averaging::Linear>(block, stride, sizeToAverage, channels, light).linearMean(light) : sumBlock<Averaging::RootMeanSquare>(block, stride, sizeToAverage, channels, light).rootMeanSquare();
             
             if (scaleUp)
             {
@@ -116,12 +268,53 @@ Image Image::scaledFromSourceHelper(unsigned char *image, size_t width, size_t h
     return Image(std::unique_ptr<unsigned char, decltype(&std::free)>(resultImage, &std::free), (scaleUp ? resultWidth * sizeToAverage : resultWidth), (scaleUp ? resultHeight * sizeToAverage : resultHeight), outChannels);
 }
 
-Image Image::scaledFromSource(unsigned char *image, size_t width, size_t height, int channels, size_t stride)
+Image Image::scaledFromSource(unsigned char *image, size_t width, size_t height, int channels, size_t stride, Averaging averaging)
+{
+    return scaledFromSourceHelper(image, width, height, channels, CHANNELS, stride, false, averaging);
+}
+
+Image Image::scaledFromSourceForSaving(unsigned char *image, size_t width, size_t height, int channels, int outChannels, size_t stride, Averaging averaging)
 {
-    return scaledFromSourceHelper(image, width, height, channels, CHANNELS, stride, false);
+    return scaledFromSourceHelper(image, width, height, channels, outChannels, stride, true, averaging);
 }
 
-Image Image::scaledFromSourceForSaving(unsigned char *image, size_t width, size_t height, int channels, int outChannels, size_t stride)
+Image Image::scaledFromLuminance(unsigned char *image, size_t width, size_t height, int channels, size_t stride, Averaging averaging)
 {
-    return scaledFromSourceHelper(image, width, height, channels, outChannels, stride, true);
+    const int numDivisions = divisionsForSize(width, height);
+    const size_t sizeToAverage = (size_t)1 << numDivisions;
+    const size_t resultWidth = width >> numDivisions;
+    const size_t resultHeight = height >> numDivisions;
+    unsigned char *resultImage = (unsigned char *)malloc(resultWidth * resultHeight * LUMINANCE_CHANNELS * sizeof(unsigned char));
+    const long long avgBase = (long long)(sizeToAverage * sizeToAverage);
+    const LinearLight &light = LinearLight::tables();
+    const bool linear = averaging == Averaging::Linear;
+    
+    for (size_t j = 0; j < resultHeight; j++)
+    {
+        for (size_t i = 0; i < resultWidth; i++)
+        {
+            // same averaging as the RGB kernel, one component and walking rows in memory order
+            long long sum = 0;
+            for (size_t y = 0; y < sizeToAverage; y++)
+            {
+                const unsigned char *row = image + (j * sizeToAverage + y) * stride + i * sizeToAverage * channels;
+                for (size_t x = 0; x < sizeToAverage; x++)
+                {
+                    const int value = row[x * channels];
+                    sum += linear ? light.toLinear[value] : value * value;
+                }
+            }
+            
+            if (linear)
+            {
+                resultImage[j * resultWidth + i] = light.fromLinear[((sum + avgBase / 2) / avgBase) >> (LinearLight::BITS - LinearLight::INDEX_BITS)];
+            }
+            else
+            {
+                resultImage[j * resultWidth + i] = (unsigned char)sqrt(sum / avgBase);
+            }
+        }
+    }
+    
+    return Image(std::unique_ptr<unsigned char, decltype(&std::free)>(resultImage, &std::free), resultWidth, resultHeight, LUMINANCE_CHANNELS);
 }
@@ -11,7 +11,7 @@
 
 #include <memory>
 
-// images are all RGB
+// images are RGB, or single channel luminance for grayscale sources
 template <typename deleter>
 struct GenericImage
 {
@@ -38,17 +38,35 @@ struct Image : public GenericImage<decltype(&std::free)>
         
     }
     
+    // how a block of source pixels becomes one cell. RootMeanSquare approximates gamma correct
+    // averaging by squaring the sRGB values; Linear converts them to linear light through a
+    // table, takes the mean there and converts back through another, for about the same cost
+    enum class Averaging
+    {
+        RootMeanSquare,
+        Linear
+    };
+    
 #if !defined(IOS)
     static Image loadImage(const char *filePath);
+    
+    // loads and scales in one step. JPEGs are averaged straight from their Y/Cb/Cr planes,
+    // each pixel converted to RGB from its luma and the chroma samples it sits in, so the
+    // upsampled RGB image is never built and both averagings match the decoded image's.
+    // grayscale sources (or any source when grayscale is set) come back as single channel
+    static Image loadScaledImage(const char *filePath, bool grayscale = false, Averaging averaging = Averaging::RootMeanSquare);
 #endif
-    static Image scaledFromSource(const Image &original);
-    static Image scaledFromSource(unsigned char *image, size_t width, size_t height, int channels, size_t stride);
+    static Image scaledFromSource(const Image &original, Averaging averaging = Averaging::RootMeanSquare);
+    static Image scaledFromSource(unsigned char *image, size_t width, size_t height, int channels, size_t stride, Averaging averaging = Averaging::RootMeanSquare);
+    
+    // averages only the first channel of each pixel, producing a single channel image
+    static Image scaledFromLuminance(unsigned char *image, size_t width, size_t height, int channels, size_t stride, Averaging averaging = Averaging::RootMeanSquare);
     
     // scales the image down and back up for saving to disk. out channels can be used to pad RGB to RGBA but the A isn't written to
-    static Image scaledFromSourceForSaving(unsigned char *image, size_t width, size_t height, int channels, int outChannels, size_t stride);
+    static Image scaledFromSourceForSaving(unsigned char *image, size_t width, size_t height, int channels, int outChannels, size_t stride, Averaging averaging = Averaging::RootMeanSquare);
     
 private:
-    static Image scaledFromSourceHelper(unsigned char *image, size_t width, size_t height, int channels, int outChannels, size_t stride, bool scaleUp);
+    static Image scaledFromSourceHelper(unsigned char *image, size_t width, size_t height, int channels, int outChannels, size_t stride, bool scaleUp, Averaging averaging);
 };
 
 #endif /* Image_hpp */
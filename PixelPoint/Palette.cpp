@@ -0,0 +1,432 @@
+//
+//  Palette.cpp
+//  PixelPoint
+//
+//  Created by Kelsey Steeves on 2026-10-19.
+//  Copyright © 2026 Kelsey Steeves. All rights reserved.
+//
+
+#include "Palette.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+static const int COMPONENTS_PER_CELL = 3;
+
+// far enough from any real color that padding is never nearest, close enough that its squared
+// distance still fits 32 bits
+static const int32_t PADDING = 1 << 12;
+
+static Color cellColor(const unsigned char *cell, int channels)
+{
+    return channels < COMPONENTS_PER_CELL ? Color(cell[0], cell[0], cell[0]) : Color(cell);
+}
+
+// threads kept waiting between jobs, so work that is split the same way many times in a row
+// (every k-means iteration) starts them once. each job splits [0, count) into one share per
+// thread, the calling thread taking the first
+class ShareWorkers
+{
+public:
+    explicit ShareWorkers(size_t threadCount)
+    : job(nullptr), count(0), share(0), generation(0), pending(0), stopping(false)
+    {
+        for (size_t i = 1; i < threadCount; i++)
+        {
+            threads.emplace_back(&ShareWorkers::work, this, i);
+        }
+    }
+    
+    ~ShareWorkers()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        started.notify_all();
+        
+        for (std::thread &thread : threads)
+        {
+            thread.join();
+        }
+    }
+    
+    // returns once every share is done
+    void run(size_t count, const std::function<void(size_t first, size_t last)> &job)
+    {
+        const size_t share = (count + threads.size()) / (threads.size() + 1);
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            this->job = &job;
+            this->count = count;
+            this->share = share;
+            pending = threads.size();
+            generation++;
+        }
+        started.notify_all();
+        
+        job(0, std::min(share, count));
+        
+        std::unique_lock<std::mutex> lock(mutex);
+        finished.wait(lock, [this] { return pending == 0; });
+    }
+    
+private:
+    void work(size_t index)
+    {
+        size_t seen = 0;
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true)
+        {
+            started.wait(lock, [this, seen] { return stopping || generation != seen; });
+            if (stopping)
+            {
+                return;
+            }
+            seen = generation;
+            
+            const size_t first = std::min(index * share, count);
+            const size_t last = std::min(first + share, count);
+            const std::function<void(size_t, size_t)> &current = *job;
+            lock.unlock();
+            if (first < last)
+            {
+                current(first, last);
+            }
+            lock.lock();
+            
+            if (--pending == 0)
+            {
+                finished.notify_one();
+            }
+        }
+    }
+    
+    std::vector<std::thread> threads;
+    std::mutex mutex;
+    std::condition_variable started;
+    std::condition_variable finished;
+    
+    const std::function<void(size_t, size_t)> *job;
+    size_t count;
+    size_t share;
+    size_t generation;
+    size_t pending;
+    bool stopping;
+};
+
+static size_t threadsForCells(size_t cellCount, size_t parallelCells)
+{
+    return cellCount < parallelCells ? 1 : std::max(1u, std::thread::hardware_concurrency());
+}
+
+Palette::Palette()
+{
+}
+
+Palette::Palette(const std::vector<Color> &colors)
+: entries(colors.begin(), colors.begin() + std::min(colors.size(), MAX_COLORS))
+{
+    const size_t padded = (entries.size() + LANES - 1) / LANES * LANES;
+    reds.assign(padded, PADDING);
+    greens.assign(padded, PADDING);
+    blues.assign(padded, PADDING);
+    for (size_t i = 0; i < entries.size(); i++)
+    {
+        reds[i] = entries[i].red;
+        greens[i] = entries[i].green;
+        blues[i] = entries[i].blue;
+    }
+}
+
+Palette Palette::medianCut(const unsigned char *cells, size_t cellCount, int channels, size_t count)
+{
+    count = std::min(count, MAX_COLORS);
+    if (cellCount == 0 || count == 0)
+    {
+        return Palette();
+    }
+    
+    std::vector<Color> samples(cellCount);
+    for (size_t i = 0; i < cellCount; i++)
+    {
+        samples[i] = cellColor(cells + i * channels, channels);
+    }
+    
+    // a box is a range of samples, and the side it would split along
+    struct Box
+    {
+        size_t begin;
+        size_t end;
+        unsigned char Color::*axis;
+        int extent;
+    };
+    
+    auto measure = [&samples](size_t begin, size_t end)
+    {
+        Color low(255, 255, 255), high(0, 0, 0);
+        for (size_t i = begin; i < end; i++)
+        {
+            low = Color(std::min(low.red, samples[i].red), std::min(low.green, samples[i].green), std::min(low.blue, samples[i].blue));
+            high = Color(std::max(high.red, samples[i].red), std::max(high.green, samples[i].green), std::max(high.blue, samples[i].blue));
+        }
+        
+        Box box = {begin, end, &Color::red, high.red - low.red};
+        if (high.green - low.green > box.extent)
+        {
+            box.axis = &Color::green;
+            box.extent = high.green - low.green;
+        }
+        if (high.blue - low.blue > box.extent)
+        {
+            box.axis = &Color::blue;
+            box.extent = high.blue - low.blue;
+        }
+        return box;
+    };
+    
+    std::vector<Box> boxes(1, measure(0, cellCount));
+    boxes.reserve(count);
+    while (boxes.size() < count)
+    {
+        auto widest = std::max_element(boxes.begin(), boxes.end(), [](const Box &a, const Box &b) { return a.extent < b.extent; });
+        if (widest->extent == 0)
+        {
+            break;
+        }
+        
+        const Box box = *widest;
+        const size_t median = box.begin + (box.end - box.begin) / 2;
+        const auto axis = box.axis;
+        std::nth_element(samples.begin() + box.begin, samples.begin() + median, samples.begin() + box.end, [axis](const Color &a, const Color &b) { return a.*axis < b.*axis; });
+        
+        *widest = measure(box.begin, median);
+        boxes.push_back(measure(median, box.end));
+    }
+    
+    std::vector<Color> colors;
+    colors.reserve(boxes.size());
+    for (const Box &box : boxes)
+    {
+        ColorAccumulator sum;
+        for (size_t i = box.begin; i < box.end; i++)
+        {
+            sum.add(samples[i]);
+        }
+        colors.push_back(sum.mean());
+    }
+    
+    return Palette(colors);
+}
+
+Palette Palette::kMeans(const unsigned char *cells, size_t cellCount, int channels, size_t count, int iterations)
+{
+    Palette palette = medianCut(cells, cellCount, channels, count);
+    if (palette.size() < 2)
+    {
+        return palette;
+    }
+    
+    std::vector<uint8_t> indices(cellCount), next(cellCount);
+    std::vector<ColorAccumulator> sums;
+    
+    // one set of threads serves every iteration's assignment
+    ShareWorkers workers(threadsForCells(cellCount, PARALLEL_CELLS));
+    for (int iteration = 0; iteration < iterations; iteration++)
+    {
+        workers.run(cellCount, [&palette, cells, channels, &next](size_t first, size_t last)
+        {
+            palette.assignRange(cells, first, last, channels, next.data());
+        });
+        if (iteration > 0 && next == indices)
+        {
+            break;
+        }
+        indices.swap(next);
+        
+        sums.assign(palette.size(), ColorAccumulator());
+        for (size_t i = 0; i < cellCount; i++)
+        {
+            sums[indices[i]].add(cellColor(cells + i * channels, channels));
+        }
+        
+        // a color no cell is nearest to stays where it is
+        std::vector<Color> colors = palette.entries;
+        for (size_t i = 0; i < colors.size(); i++)
+        {
+            if (sums[i].count)
+            {
+                colors[i] = sums[i].mean();
+            }
+        }
+        palette = Palette(colors);
+    }
+    
+    return palette;
+}
+
+void Palette::assign(const unsigned char *cells, size_t cellCount, int channels, uint8_t *indices, size_t threads) const
+{
+    if (entries.empty())
+    {
+        std::fill(indices, indices + cellCount, 0);
+        return;
+    }
+    
+    const size_t threadCount = threads ? threads : threadsForCells(cellCount, PARALLEL_CELLS);
+    if (threadCount == 1)
+    {
+        assignRange(cells, 0, cellCount, channels, indices);
+        return;
+    }
+    
+    ShareWorkers(threadCount).run(cellCount, [this, cells, channels, indices](size_t first, size_t last)
+    {
+        assignRange(cells, first, last, channels, indices);
+    });
+}
+
+void Palette::assignRange(const unsigned char *cells, size_t first, size_t last, int channels, uint8_t *indices) const
+{
+    const unsigned char *cell = cells + first * channels;
+    for (size_t i = first; i < last; i++, cell += channels)
+    {
+        const Color color = cellColor(cell, channels);
+        indices[i] = (uint8_t)nearest(color.red, color.green, color.blue);
+    }
+}
+
+size_t Palette::nearest(const Color &color) const
+{
+    return entries.empty() ? 0 : nearest(color.red, color.green, color.blue);
+}
+
+size_t Palette::nearest(int red, int green, int blue) const
+{
+    // each lane keeps the nearest of the colors that fall in it, so the loop over blocks is all
+    // compares and selects
+    int32_t bestDistances[LANES];
+    int32_t bestIndices[LANES];
+    for (size_t lane = 0; lane < LANES; lane++)
+    {
+        bestDistances[lane] = INT32_MAX;
+        bestIndices[lane] = 0;
+    }
+    
+    const size_t padded = reds.size();
+    const int32_t *r = reds.data(), *g = greens.data(), *b = blues.data();
+    for (size_t block = 0; block < padded; block += LANES)
+    {
+        for (size_t lane = 0; lane < LANES; lane++)
+        {
+            const int32_t dr = r[block + lane] - red, dg = g[block + lane] - green, db = b[block + lane] - blue;
+            const int32_t distance = dr * dr + dg * dg + db * db;
+            const bool nearer = distance < bestDistances[lane];
+            bestDistances[lane] = nearer ? distance : bestDistances[lane];
+            bestIndices[lane] = nearer ? (int32_t)(block + lane) : bestIndices[lane];
+        }
+    }
+    
+    // ties go to the earlier color
+    size_t best = 0;
+    for (size_t lane = 1; lane < LANES; lane++)
+    {
+        if (bestDistances[lane] < bestDistances[best] || (bestDistances[lane] == bestDistances[best] && bestIndices[lane] < bestIndices[best]))
+        {
+            best = lane;
+        }
+    }
+    
+    return bestIndices[best];
+}
+
+void Palette::remap(unsigned char *colors, size_t cellCount) const
+{
+    if (entries.empty())
+    {
+        return;
+    }
+    
+    std::vector<uint8_t> indices(cellCount);
+    assign(colors, cellCount, COMPONENTS_PER_CELL, indices.data());
+    for (size_t i = 0; i < cellCount; i++, colors += COMPONENTS_PER_CELL)
+    {
+        const Color &color = entries[indices[i]];
+        colors[0] = color.red;
+        colors[1] = color.green;
+        colors[2] = color.blue;
+    }
+}
+
+const std::vector<Color> &Palette::colors() const
+{
+    return entries;
+}
+
+size_t Palette::size() const
+{
+    return entries.size();
+}
+
+bool Palette::empty() const
+{
+    return entries.empty();
+}
+
+uint64_t Palette::hash() const
+{
+    // FNV-1a over the color words
+    uint64_t hash = 14695981039346656037ull;
+    for (const Color &color : entries)
+    {
+        hash = (hash ^ color.word()) * 1099511628211ull;
+    }
+    return hash;
+}
+
+bool Palette::operator==(const Palette &other) const
+{
+    return entries == other.entries;
+}
+
+IndexedImage::IndexedImage(Image indices, const Palette &palette)
+: indices(std::move(indices)), palette(palette)
+{
+}
+
+IndexedImage::IndexedImage(IndexedImage &&other)
+: indices(std::move(other.indices)), palette(std::move(other.palette))
+{
+}
+
+IndexedImage IndexedImage::quantize(const Image &image, const Palette &palette)
+{
+    uint8_t *indices = (uint8_t *)malloc(image.width * image.height);
+    palette.assign(image.data.get(), image.width * image.height, image.channels, indices);
+    
+    return IndexedImage(Image(std::unique_ptr<unsigned char, decltype(&std::free)>(indices, &std::free), image.width, image.height, 1), palette);
+}
+
+Image IndexedImage::expanded() const
+{
+    if (palette.empty())
+    {
+        return Image(std::unique_ptr<unsigned char, decltype(&std::free)>(nullptr, &std::free), 0, 0, COMPONENTS_PER_CELL);
+    }
+    
+    const size_t cellCount = indices.width * indices.height;
+    unsigned char *rgb = (unsigned char *)malloc(cellCount * COMPONENTS_PER_CELL);
+    const uint8_t *index = indices.data.get();
+    for (size_t i = 0; i < cellCount; i++)
+    {
+        const Color &color = palette.colors()[index[i]];
+        rgb[i * COMPONENTS_PER_CELL] = color.red;
+        rgb[i * COMPONENTS_PER_CELL + 1] = color.green;
+        rgb[i * COMPONENTS_PER_CELL + 2] = color.blue;
+    }
+    
+    return Image(std::unique_ptr<unsigned char, decltype(&std::free)>(rgb, &std::free), indices.width, indices.height, COMPONENTS_PER_CELL);
+}
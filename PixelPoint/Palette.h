@@ -0,0 +1,89 @@
+//
+//  Palette.hpp
+//  PixelPoint
+//
+//  Created by Kelsey Steeves on 2026-10-19.
+//  Copyright © 2026 Kelsey Steeves. All rights reserved.
+//
+
+#ifndef Palette_hpp
+#define Palette_hpp
+
+#include "Color.h"
+#include "Image.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// a small set of colors (at most 256, so an index fits a byte) to reduce pixelated cells to.
+// building one is the expensive part and only looks at colors, so a palette built from one video
+// frame can keep being applied to the frames after it, which then only pay for assign. cell
+// colors are read from row order images of 1 (luminance), 3 or 4 channels
+class Palette
+{
+public:
+    static const size_t MAX_COLORS = 256;
+    
+    Palette();
+    explicit Palette(const std::vector<Color> &colors);
+    
+    // splits the box around the colors at the median of its longest side, widest box first,
+    // until there are count boxes or none can split, then takes the mean of each box
+    static Palette medianCut(const unsigned char *cells, size_t cellCount, int channels, size_t count);
+    
+    // refines a median cut palette by moving each color to the mean of the cells nearest it,
+    // stopping early once no cell changes color
+    static Palette kMeans(const unsigned char *cells, size_t cellCount, int channels, size_t count, int iterations = 8);
+    
+    // the index of the nearest color (by squared RGB distance) for every cell. threads is how
+    // many to split the cells across; 0 uses one per CPU once there are PARALLEL_CELLS cells
+    void assign(const unsigned char *cells, size_t cellCount, int channels, uint8_t *indices, size_t threads = 0) const;
+    size_t nearest(const Color &color) const;
+    
+    // replaces every cell of a row order RGB grid with its nearest color
+    void remap(unsigned char *colors, size_t cellCount) const;
+    
+    const std::vector<Color> &colors() const;
+    size_t size() const;
+    bool empty() const;
+    
+    // of the colors in order, for finding a palette again (see PaletteTable)
+    uint64_t hash() const;
+    bool operator==(const Palette &other) const;
+    
+private:
+    // distances are worked out a block of this many colors at a time, one color per lane
+    static const size_t LANES = 8;
+    
+    // assignment is split across threads from this many cells up
+    static const size_t PARALLEL_CELLS = 1 << 16;
+    
+    void assignRange(const unsigned char *cells, size_t first, size_t last, int channels, uint8_t *indices) const;
+    size_t nearest(int red, int green, int blue) const;
+    
+    std::vector<Color> entries;
+    
+    // the colors one channel at a time, padded to a multiple of LANES with colors too far away to
+    // ever be nearest, so the distance loop has no tail and compilers can vectorize it
+    std::vector<int32_t> reds;
+    std::vector<int32_t> greens;
+    std::vector<int32_t> blues;
+};
+
+// a pixelated image as one palette index per cell, plus the palette
+struct IndexedImage
+{
+    IndexedImage(Image indices, const Palette &palette);
+    IndexedImage(IndexedImage &&other);
+    
+    static IndexedImage quantize(const Image &image, const Palette &palette);
+    
+    // back to an RGB image, or an empty one when there is no palette to look indices up in
+    Image expanded() const;
+    
+    Image indices;
+    Palette palette;
+};
+
+#endif /* Palette_hpp */
@@ -0,0 +1,279 @@
+//
+//  PaletteTable.cpp
+//  PixelPoint
+//
+//  Created by Kelsey Steeves on 2026-10-19.
+//  Copyright © 2026 Kelsey Steeves. All rights reserved.
+//
+
+#include "PaletteTable.h"
+
+#include <algorithm>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+static const int COMPONENTS_PER_CELL = 3;
+
+// box index of a component
+static const int SHIFT = 8 - PaletteTable::BITS;
+
+// the most recently used tables first
+static std::mutex cacheMutex;
+static std::vector<std::shared_ptr<const PaletteTable>> cache;
+
+PaletteTable::PaletteTable(const Palette &palette)
+: colors(palette), hash(palette.hash()), boxes(BOXES, 0)
+{
+    if (colors.empty())
+    {
+        offsets.push_back(0);
+        return;
+    }
+    
+    // red slices are shared out between threads, the calling thread taking the first share.
+    // each numbers its ambiguous boxes from 0, so they are renumbered in slice order after
+    const int sides = 1 << BITS;
+    const int threadCount = std::min(sides, (int)std::max(1u, std::thread::hardware_concurrency()));
+    const int share = (sides + threadCount - 1) / threadCount;
+    std::vector<std::vector<uint8_t>> threadLists(threadCount);
+    std::vector<std::vector<uint32_t>> threadOffsets(threadCount);
+    std::vector<std::thread> workers;
+    for (int i = 1; i < threadCount && i * share < sides; i++)
+    {
+        workers.emplace_back(&PaletteTable::buildSlices, this, i * share, std::min((i + 1) * share, sides), std::ref(threadLists[i]), std::ref(threadOffsets[i]));
+    }
+    buildSlices(0, std::min(share, sides), threadLists[0], threadOffsets[0]);
+    
+    for (std::thread &worker : workers)
+    {
+        worker.join();
+    }
+    
+    size_t ambiguous = 0;
+    for (int i = 0; i < threadCount && i * share < sides; i++)
+    {
+        const size_t firstBox = (size_t)(i * share) << (2 * BITS);
+        const size_t lastBox = (size_t)std::min((i + 1) * share, sides) << (2 * BITS);
+        for (size_t box = firstBox; box < lastBox; box++)
+        {
+            if (boxes[box] >= Palette::MAX_COLORS)
+            {
+                boxes[box] += ambiguous;
+            }
+        }
+        
+        const uint32_t base = (uint32_t)lists.size();
+        for (uint32_t offset : threadOffsets[i])
+        {
+            offsets.push_back(base + offset);
+        }
+        lists.insert(lists.end(), threadLists[i].begin(), threadLists[i].end());
+        ambiguous += threadOffsets[i].size();
+    }
+    offsets.push_back((uint32_t)lists.size());
+}
+
+void PaletteTable::buildSlices(int firstRed, int lastRed, std::vector<uint8_t> &lists, std::vector<uint32_t> &offsets)
+{
+    const std::vector<Color> &entries = colors.colors();
+    const size_t count = entries.size();
+    const int sides = 1 << BITS;
+    const int span = 1 << SHIFT;
+    
+    // squared distances along each axis from every color to the nearest and farthest value of
+    // every slice, by slice then color
+    std::vector<int32_t> nearAxis[COMPONENTS_PER_CELL], farAxis[COMPONENTS_PER_CELL];
+    for (int axis = 0; axis < COMPONENTS_PER_CELL; axis++)
+    {
+        nearAxis[axis].resize(sides * count);
+        farAxis[axis].resize(sides * count);
+        for (int slice = 0; slice < sides; slice++)
+        {
+            const int low = slice * span, high = low + span - 1;
+            for (size_t i = 0; i < count; i++)
+            {
+                const int value = (&entries[i].red)[axis];
+                const int nearest = value < low ? low - value : (value > high ? value - high : 0);
+                const int farthest = std::max(value - low, high - value);
+                nearAxis[axis][slice * count + i] = nearest * nearest;
+                farAxis[axis][slice * count + i] = farthest * farthest;
+            }
+        }
+    }
+    
+    std::vector<int32_t> nearDistances(count);
+    std::vector<uint8_t> candidates;
+    for (int red = firstRed; red < lastRed; red++)
+    {
+        for (int green = 0; green < sides; green++)
+        {
+            for (int blue = 0; blue < sides; blue++)
+            {
+                const int32_t *nearRed = &nearAxis[0][red * count], *nearGreen = &nearAxis[1][green * count], *nearBlue = &nearAxis[2][blue * count];
+                const int32_t *farRed = &farAxis[0][red * count], *farGreen = &farAxis[1][green * count], *farBlue = &farAxis[2][blue * count];
+                
+                // no point in the box is farther than bound from its nearest color, so only
+                // colors that come within bound of the box can be nearest anywhere in it
+                int32_t bound = INT32_MAX;
+                size_t closest = 0;
+                for (size_t i = 0; i < count; i++)
+                {
+                    nearDistances[i] = nearRed[i] + nearGreen[i] + nearBlue[i];
+                    const int32_t farDistance = farRed[i] + farGreen[i] + farBlue[i];
+                    closest = farDistance < bound ? i : closest;
+                    bound = std::min(bound, farDistance);
+                }
+                
+                candidates.clear();
+                for (size_t i = 0; i < count; i++)
+                {
+                    if (nearDistances[i] <= bound)
+                    {
+                        candidates.push_back((uint8_t)i);
+                    }
+                }
+                
+                // then drop colors another one beats everywhere in the box. the difference of
+                // two squared distances is linear, so its minimum is at a corner, found an axis
+                // at a time. only strict wins count, so tied colors stay and the first still wins.
+                // the color with the bound beats most, so it goes first
+                const int lows[COMPONENTS_PER_CELL] = {red * span, green * span, blue * span};
+                auto beats = [&](size_t winner, size_t loser)
+                {
+                    const Color &color = entries[loser], &other = entries[winner];
+                    int lead = 0;
+                    for (int axis = 0; axis < COMPONENTS_PER_CELL; axis++)
+                    {
+                        const int a = (&color.red)[axis], b = (&other.red)[axis];
+                        const int low = lows[axis], high = low + span - 1;
+                        lead += std::min((b - a) * (2 * low - a - b), (b - a) * (2 * high - a - b));
+                    }
+                    return lead > 0;
+                };
+                
+                candidates.erase(std::remove_if(candidates.begin(), candidates.end(), [&](uint8_t i) { return beats(closest, i); }), candidates.end());
+                size_t kept = 0;
+                for (size_t i = 0; i < candidates.size(); i++)
+                {
+                    bool beaten = false;
+                    for (size_t j = 0; j < candidates.size() && !beaten; j++)
+                    {
+                        beaten = beats(candidates[j], candidates[i]);
+                    }
+                    if (!beaten)
+                    {
+                        candidates[kept++] = candidates[i];
+                    }
+                }
+                candidates.resize(kept);
+                
+                const size_t box = (size_t)red << (2 * BITS) | (size_t)green << BITS | (size_t)blue;
+                if (candidates.size() == 1)
+                {
+                    boxes[box] = candidates[0];
+                    continue;
+                }
+                
+                boxes[box] = (uint16_t)(Palette::MAX_COLORS + offsets.size());
+                offsets.push_back((uint32_t)lists.size());
+                lists.insert(lists.end(), candidates.begin(), candidates.end());
+            }
+        }
+    }
+}
+
+std::shared_ptr<const PaletteTable> PaletteTable::forPalette(const Palette &palette)
+{
+    const uint64_t hash = palette.hash();
+    {
+        std::lock_guard<std::mutex> lock(cacheMutex);
+        for (auto table = cache.begin(); table != cache.end(); ++table)
+        {
+            if ((*table)->hash == hash && (*table)->colors == palette)
+            {
+                std::rotate(cache.begin(), table, table + 1);
+                return cache.front();
+            }
+        }
+    }
+    
+    // built outside the lock, so lookups of other palettes don't wait on it
+    std::shared_ptr<const PaletteTable> table = std::make_shared<PaletteTable>(palette);
+    
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    cache.insert(cache.begin(), table);
+    if (cache.size() > CACHE_SIZE)
+    {
+        cache.pop_back();
+    }
+    return table;
+}
+
+size_t PaletteTable::nearest(const Color &color) const
+{
+    return nearest(color.red, color.green, color.blue);
+}
+
+size_t PaletteTable::nearest(int red, int green, int blue) const
+{
+    const uint16_t entry = boxes[(size_t)(red >> SHIFT) << (2 * BITS) | (size_t)(green >> SHIFT) << BITS | (size_t)(blue >> SHIFT)];
+    if (entry < Palette::MAX_COLORS)
+    {
+        return entry;
+    }
+    
+    // candidates are in palette order, so the first of equally near colors wins like it does
+    // in Palette::nearest
+    const std::vector<Color> &entries = colors.colors();
+    const size_t ambiguous = entry - Palette::MAX_COLORS;
+    size_t best = 0;
+    int32_t bestDistance = INT32_MAX;
+    for (uint32_t i = offsets[ambiguous]; i < offsets[ambiguous + 1]; i++)
+    {
+        const Color &color = entries[lists[i]];
+        const int32_t dr = color.red - red, dg = color.green - green, db = color.blue - blue;
+        const int32_t distance = dr * dr + dg * dg + db * db;
+        if (distance < bestDistance)
+        {
+            bestDistance = distance;
+            best = lists[i];
+        }
+    }
+    return best;
+}
+
+void PaletteTable::assign(const unsigned char *cells, size_t cellCount, int channels, uint8_t *indices) const
+{
+    for (size_t i = 0; i < cellCount; i++, cells += channels)
+    {
+        indices[i] = (uint8_t)(channels < COMPONENTS_PER_CELL ? nearest(cells[0], cells[0], cells[0]) : nearest(cells[0], cells[1], cells[2]));
+    }
+}
+
+void PaletteTable::remap(unsigned char *colors, size_t cellCount) const
+{
+    if (this->colors.empty())
+    {
+        return;
+    }
+    
+    const std::vector<Color> &entries = this->colors.colors();
+    for (size_t i = 0; i < cellCount; i++, colors += COMPONENTS_PER_CELL)
+    {
+        const Color &color = entries[nearest(colors[0], colors[1], colors[2])];
+        colors[0] = color.red;
+        colors[1] = color.green;
+        colors[2] = color.blue;
+    }
+}
+
+const Palette &PaletteTable::palette() const
+{
+    return colors;
+}
+
+size_t PaletteTable::ambiguousBoxes() const
+{
+    return offsets.size() - 1;
+}
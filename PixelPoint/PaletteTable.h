@@ -0,0 +1,66 @@
+//
+//  PaletteTable.hpp
+//  PixelPoint
+//
+//  Created by Kelsey Steeves on 2026-10-19.
+//  Copyright © 2026 Kelsey Steeves. All rights reserved.
+//
+
+#ifndef PaletteTable_hpp
+#define PaletteTable_hpp
+
+#include "Palette.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// answers Palette::nearest with one lookup instead of a pass over the palette. RGB space is cut
+// into 32 x 32 x 32 boxes; a box that only one color can be nearest to anywhere inside stores
+// that color, and the rest store the short list of colors that could be, which are searched
+// exactly. so lookups always agree with Palette::nearest, ties included. building one takes a
+// pass over the palette per box, split across threads, and tables are cached by palette so
+// switching back to a recent palette costs nothing
+class PaletteTable
+{
+public:
+    explicit PaletteTable(const Palette &palette);
+    
+    // the table for a palette, built on first use and kept while it is one of the few most
+    // recently asked for. safe to call from any thread
+    static std::shared_ptr<const PaletteTable> forPalette(const Palette &palette);
+    
+    size_t nearest(const Color &color) const;
+    
+    // the same as Palette::assign and Palette::remap
+    void assign(const unsigned char *cells, size_t cellCount, int channels, uint8_t *indices) const;
+    void remap(unsigned char *colors, size_t cellCount) const;
+    
+    const Palette &palette() const;
+    
+    // boxes that fall back to searching a list, out of BOXES
+    size_t ambiguousBoxes() const;
+    
+    static const int BITS = 5;
+    static const size_t BOXES = (size_t)1 << (3 * BITS);
+    
+private:
+    // how many tables forPalette keeps
+    static const size_t CACHE_SIZE = 4;
+    
+    void buildSlices(int firstRed, int lastRed, std::vector<uint8_t> &lists, std::vector<uint32_t> &offsets);
+    size_t nearest(int red, int green, int blue) const;
+    
+    Palette colors;
+    uint64_t hash;
+    
+    // per box, a palette index, or MAX_COLORS plus the number of an ambiguous box
+    std::vector<uint16_t> boxes;
+    
+    // the candidate indices of ambiguous box n are lists[offsets[n]] up to lists[offsets[n + 1]]
+    std::vector<uint32_t> offsets;
+    std::vector<uint8_t> lists;
+};
+
+#endif /* PaletteTable_hpp */
@@ -7,6 +7,7 @@
 //
 
 #include "Image.h"
+#include "Scene.h"
 
 #if IOS
 #include <OpenGLES/ES3/gl.h>
@@ -15,32 +16,119 @@
 #include <OpenGL/gl3.h>
 #endif
 
+#include <atomic>
+#include <memory>
 #include <vector>
 
 class PixelPointRenderer
 {
 public:
-    PixelPointRenderer();
+    // Quads draws every cell as an instance of one unit quad, with a color per instance, which
+    // Quad hit testing and editing rely on. Texture uploads the pixelated image as a nearest
+    // sampled texture drawn on one quad
+    enum class Mode
+    {
+        Quads,
+        Texture
+    };
+    
+    PixelPointRenderer(Mode mode = Mode::Quads);
     ~PixelPointRenderer();
     
     void render();
     void loadTexture(const Image &image);
     void clear();
     
-    static std::vector<GLfloat> vertices;
-    static std::vector<GLuint> elements;
+    // takes over a scene built elsewhere, e.g. on a worker thread, and uploads it. the current
+    // scene's overlay moves to it unless it has its own
+    void loadScene(std::unique_ptr<Scene> next);
+    
+    // uploads a scene the caller keeps, like a frame handed over from a capture thread. the
+    // colors are copied into the renderer's own scene first, so edits can be made over them
+    void loadTexture(const Scene &source);
+    
+    // content, transform (rotation, flip) and anything set through setNeedsDisplay, like a
+    // viewport change, make the next frame dirty. renderIfNeeded skips clean frames entirely
+    bool needsDisplay() const;
+    void setNeedsDisplay();
+    bool renderIfNeeded();
+    
+    // the grid being drawn. its colors are the per-instance color stream (the texture in Texture
+    // mode), and its cell edits are uploaded in as few merged ranges (spans of texture rows) as
+    // possible at the next render, on the GL thread
+    std::unique_ptr<Scene> scene;
     
     float viewport[4];
     float rotation;
     bool flip[2];
     float scale[2];
     
+    // GPU upload accounting. storage is (re)allocated only when the grid size changes (once per
+    // stream slot), so once the size is steady every loadTexture should only add to colorBytes.
+    // stalls counts uploads that found their slot still in use by the GPU; those respecify the
+    // storage so the driver can orphan it rather than block. edits that find the drawn slot in
+    // use count too, and go up with the whole stream in the next slot
+    struct UploadCounters
+    {
+        size_t allocations;
+        size_t allocatedBytes;
+        size_t colorUploads;
+        size_t colorBytes;
+        size_t stalls;
+        size_t editUploads;
+        size_t editBytes;
+    };
+    UploadCounters uploads;
+    
+    size_t framesRendered;
+    size_t framesSkipped;
+    
 private:
+    // uploads rotate through a few buffers (textures in Texture mode) so a frame never writes
+    // storage an earlier draw may still be reading. the fence marks the last draw from the slot
+    struct StreamSlot
+    {
+        GLuint name;
+        GLsync fence;
+        size_t width;
+        size_t height;
+        int channels;
+    };
+    static const int STREAM_SLOTS = 3;
+    
+    StreamSlot &nextSlot(bool &inFlight);
+    bool isInFlight(const StreamSlot &slot) const;
+    void flushEdits();
+    void flushTextureEdits();
+    void uploadScene();
+    void uploadTexture(const unsigned char *data, size_t width, size_t height, int channels);
+    
+    // luminance scenes go up one byte per cell, straight from the image when the caller has it
+    void uploadCells(const unsigned char *luminanceCells = nullptr);
+    const unsigned char *gatherLuminance(size_t first, size_t count);
+    
+    const Mode mode;
+    
     GLuint vao;
     GLuint vbo;
-    GLuint ebo;
     
     GLuint shaderProgram;
     GLint posAttrib;
     GLint colAttrib;
+    GLint gridSizeUniform;
+    GLint transformUniform;
+    
+    // the matrix is only rebuilt when the rotation or flip it was built from change
+    float transform[4];
+    float transformRotation;
+    bool transformFlip[2];
+    std::atomic<bool> dirty;
+    
+    GLint luminanceUniform;
+    
+    StreamSlot slots[STREAM_SLOTS];
+    int currentSlot;
+    
+    // staging for the one byte per cell stream of a luminance scene
+    std::vector<unsigned char> luminanceCells;
 };
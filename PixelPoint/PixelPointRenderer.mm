@@ -8,19 +8,33 @@
 
 #import "PixelPointRenderer.h"
 
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
 #include <vector>
 
 // Shader sources
 #if IOS
 const GLchar* vertexSource = R"glsl(
 #version 300 es
-in vec2 position;
 in vec3 color;
 uniform mat2 transformation;
+uniform ivec2 gridSize;
+uniform bool luminance;
 out vec3 Color;
 void main()
 {
-    Color = color.bgr;
+    // cells are instanced in row order, corners come from the strip index
+    ivec2 cell = ivec2(gl_InstanceID % gridSize.x, gl_InstanceID / gridSize.x);
+    vec2 corner = vec2(gl_VertexID & 1, gl_VertexID >> 1);
+    vec2 cellSize = 2.0 / vec2(gridSize);
+    
+    float left = float(cell.x) * cellSize.x - 1.0;
+    float top = 1.0 - float(cell.y) * cellSize.y;
+    vec2 position = vec2(left + corner.x * cellSize.x, top - corner.y * cellSize.y);
+    
+    // luminance cells are one byte, which arrives as red
+    Color = luminance ? color.rrr : color.bgr;
     gl_Position = vec4(transformation * position, 0.0, 1.0);
 }
 )glsl";
@@ -36,17 +50,60 @@ void main()
 }
 )glsl";
 
+const GLchar* textureVertexSource = R"glsl(
+#version 300 es
+in vec2 position;
+in vec2 texcoord;
+uniform mat2 transformation;
+out vec2 Texcoord;
+void main()
+{
+    Texcoord = texcoord;
+    gl_Position = vec4(transformation * position, 0.0, 1.0);
+}
+)glsl";
+
+const GLchar* textureFragmentSource = R"glsl(
+#version 300 es
+precision highp float;
+in vec2 Texcoord;
+uniform sampler2D cells;
+uniform bool luminance;
+uniform mat2 transformation;
+out vec4 outColor;
+void main()
+{
+    // pixel centres exactly on a cell edge go to the cell the quad rasterizer picks, right and up
+    // on screen; mapped back through the (orthonormal) transformation into texture space
+    vec2 tieBreak = vec2(1.0, -1.0) * (vec2(1.0) * transformation) / (65536.0 * vec2(textureSize(cells, 0)));
+    vec3 color = texture(cells, Texcoord + tieBreak).rgb;
+    outColor = vec4(luminance ? color.rrr : color.bgr, 1.0);
+}
+)glsl";
+
 #else
 
 const GLchar* vertexSource = R"glsl(
 #version 150 core
-in vec2 position;
 in vec3 color;
+uniform mat2 transformation;
+uniform ivec2 gridSize;
+uniform bool luminance;
 out vec3 Color;
 void main()
 {
-    Color = color;
-    gl_Position = vec4(position, 0.0, 1.0);
+    // cells are instanced in row order, corners come from the strip index
+    ivec2 cell = ivec2(gl_InstanceID % gridSize.x, gl_InstanceID / gridSize.x);
+    vec2 corner = vec2(gl_VertexID & 1, gl_VertexID >> 1);
+    vec2 cellSize = 2.0 / vec2(gridSize);
+    
+    float left = float(cell.x) * cellSize.x - 1.0;
+    float top = 1.0 - float(cell.y) * cellSize.y;
+    vec2 position = vec2(left + corner.x * cellSize.x, top - corner.y * cellSize.y);
+    
+    // luminance cells are one byte, which arrives as red
+    Color = luminance ? color.rrr : color;
+    gl_Position = vec4(transformation * position, 0.0, 1.0);
 }
 )glsl";
 
@@ -59,52 +116,83 @@ void main()
     outColor = vec4(Color, 1.0);
 }
 )glsl";
+
+const GLchar* textureVertexSource = R"glsl(
+#version 150 core
+in vec2 position;
+in vec2 texcoord;
+uniform mat2 transformation;
+out vec2 Texcoord;
+void main()
+{
+    Texcoord = texcoord;
+    gl_Position = vec4(transformation * position, 0.0, 1.0);
+}
+)glsl";
+
+const GLchar* textureFragmentSource = R"glsl(
+#version 150 core
+in vec2 Texcoord;
+uniform sampler2D cells;
+uniform bool luminance;
+uniform mat2 transformation;
+out vec4 outColor;
+void main()
+{
+    // pixel centres exactly on a cell edge go to the cell the quad rasterizer picks, right and up
+    // on screen; mapped back through the (orthonormal) transformation into texture space
+    vec2 tieBreak = vec2(1.0, -1.0) * (vec2(1.0) * transformation) / (65536.0 * vec2(textureSize(cells, 0)));
+    vec3 color = texture(cells, Texcoord + tieBreak).rgb;
+    outColor = vec4(luminance ? color.rrr : color, 1.0);
+}
+)glsl";
 #endif
 
-static const int COMPONENTS_PER_VERTEX = 5;
+static const int COMPONENTS_PER_CELL = Scene::COMPONENTS_PER_CELL;
 
-#include "Quad.h"
+// edited cells this close together go up in one range; re-sending a few untouched cells is
+// cheaper than another glBufferSubData call
+static const size_t EDIT_MERGE_GAP = 16;
 
-void tile (unsigned char *texture, int width, int height) {
-    std::vector<GLfloat> vertices;
-    vertices.reserve(width * height * COMPONENTS_PER_VERTEX * 4);
-    
-    float elementWidth = 2.0f / width;
-    float elementHeight = 2.0f / height;
-    
-    Quad::clear();
-    
-    for (int i = 0; i < width; i++)
-    {
-        for (int j = 0; j < height; j++)
-        {
-            const float left = (i * elementWidth) - 1;
-            const float right = left + elementWidth;
-            
-            const float top = 1 - (j * elementHeight);
-            const float bottom = top - elementHeight;
-            
-            float topLeft[] = {left, top};
-            float bottomRight[] = {right, bottom};
-            
-            int red = texture[(j * width + i) * 3];
-            int green = texture[(j * width + i) * 3 + 1];
-            int blue = texture[(j * width + i) * 3 + 2];
-            
-            Quad quad(topLeft, bottomRight, Color(red, green, blue));
-            Quad::quads.push_back(quad);
-        }
-    }
-}
+// one quad over the whole viewport: position, then texcoord with the first image row at the top.
+// packed as normalized 16 bit values; -32768 and 32767 are exactly -1 and 1 under both the GL 3.2
+// and the GLES 3 signed conversion rules, and unsigned texcoords map 0 and 65535 to exactly 0 and 1
+struct TextureVertex
+{
+    GLshort position[2];
+    GLushort texcoord[2];
+};
+
+static const GLshort POSITION_MIN = -32768;
+static const GLshort POSITION_MAX = 32767;
+static const GLushort TEXCOORD_MAX = 65535;
 
-std::vector<GLfloat> PixelPointRenderer::vertices;
-std::vector<GLuint> PixelPointRenderer::elements;
+static const TextureVertex textureQuad[] = {
+    {{POSITION_MIN, POSITION_MAX}, {0, 0}},
+    {{POSITION_MAX, POSITION_MAX}, {TEXCOORD_MAX, 0}},
+    {{POSITION_MIN, POSITION_MIN}, {0, TEXCOORD_MAX}},
+    {{POSITION_MAX, POSITION_MIN}, {TEXCOORD_MAX, TEXCOORD_MAX}},
+};
 
-PixelPointRenderer::PixelPointRenderer()
-:   viewport{0.0f, 0.0f, 0.0f, 0.0f},
+PixelPointRenderer::PixelPointRenderer(Mode mode)
+:   scene(new Scene()),
+    viewport{0.0f, 0.0f, 0.0f, 0.0f},
     rotation(0.0f),
     flip{false, false},
-    scale {1.0f, 1.0f}
+    scale {1.0f, 1.0f},
+    uploads{0, 0, 0, 0, 0, 0, 0},
+    framesRendered(0),
+    framesSkipped(0),
+    mode(mode),
+    gridSizeUniform(-1),
+    transformUniform(-1),
+    transform{1.0f, 0.0f, 0.0f, 1.0f},
+    transformRotation(0.0f),
+    transformFlip{false, false},
+    dirty(true),
+    luminanceUniform(-1),
+    slots{},
+    currentSlot(-1)
 {
     // Create Vertex Array Object
     glGenVertexArrays(1, &vao);
@@ -112,17 +200,16 @@ PixelPointRenderer::PixelPointRenderer()
     // Create a Vertex Buffer Object and copy the vertex data to it
     glGenBuffers(1, &vbo);
     
-    // Create an element array
-    glGenBuffers(1, &ebo);
+    const bool textured = mode == Mode::Texture;
     
     // Create and compile the vertex shader
     GLuint vertexShader = glCreateShader(GL_VERTEX_SHADER);
-    glShaderSource(vertexShader, 1, &vertexSource, NULL);
+    glShaderSource(vertexShader, 1, textured ? &textureVertexSource : &vertexSource, NULL);
     glCompileShader(vertexShader);
     
     // Create and compile the fragment shader
     GLuint fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
-    glShaderSource(fragmentShader, 1, &fragmentSource, NULL);
+    glShaderSource(fragmentShader, 1, textured ? &textureFragmentSource : &fragmentSource, NULL);
     glCompileShader(fragmentShader);
     
     // Link the vertex and fragment shader into a shader program
@@ -131,85 +218,482 @@ PixelPointRenderer::PixelPointRenderer()
     glAttachShader(shaderProgram, fragmentShader);
     glLinkProgram(shaderProgram);
     
+    // the program keeps the shaders alive, and frees them with it
+    glDeleteShader(vertexShader);
+    glDeleteShader(fragmentShader);
+    
     posAttrib = glGetAttribLocation(shaderProgram, "position");
-    colAttrib = glGetAttribLocation(shaderProgram, "color");
+    transformUniform = glGetUniformLocation(shaderProgram, "transformation");
+    luminanceUniform = glGetUniformLocation(shaderProgram, "luminance");
+    
+    if (textured)
+    {
+        // the quad never changes, only the texture does
+        glBindVertexArray(vao);
+        glBindBuffer(GL_ARRAY_BUFFER, vbo);
+        glBufferData(GL_ARRAY_BUFFER, sizeof(textureQuad), textureQuad, GL_STATIC_DRAW);
+        uploads.allocations++;
+        uploads.allocatedBytes += sizeof(textureQuad);
+        
+        GLint texAttrib = glGetAttribLocation(shaderProgram, "texcoord");
+        glEnableVertexAttribArray(posAttrib);
+        glVertexAttribPointer(posAttrib, 2, GL_SHORT, GL_TRUE, sizeof(TextureVertex), (void*)offsetof(TextureVertex, position));
+        glEnableVertexAttribArray(texAttrib);
+        glVertexAttribPointer(texAttrib, 2, GL_UNSIGNED_SHORT, GL_TRUE, sizeof(TextureVertex), (void*)offsetof(TextureVertex, texcoord));
+        
+        for (StreamSlot &slot : slots)
+        {
+            glGenTextures(1, &slot.name);
+            glBindTexture(GL_TEXTURE_2D, slot.name);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        }
+        
+        glUseProgram(shaderProgram);
+        glUniform1i(glGetUniformLocation(shaderProgram, "cells"), 0);
+    }
+    else
+    {
+        // positions are generated in the shader, the only stream is one color per instance
+        colAttrib = glGetAttribLocation(shaderProgram, "color");
+        gridSizeUniform = glGetUniformLocation(shaderProgram, "gridSize");
+        
+        for (StreamSlot &slot : slots)
+        {
+            glGenBuffers(1, &slot.name);
+        }
+        
+        // the attribute is pointed at whichever slot each frame is uploaded to
+        glBindVertexArray(vao);
+        glEnableVertexAttribArray(colAttrib);
+        glVertexAttribDivisor(colAttrib, 1);
+    }
 }
 
 PixelPointRenderer::~PixelPointRenderer()
 {
+    // the context the renderer was created in has to be current
+    for (StreamSlot &slot : slots)
+    {
+        if (slot.fence)
+        {
+            glDeleteSync(slot.fence);
+        }
+        
+        if (mode == Mode::Texture)
+        {
+            glDeleteTextures(1, &slot.name);
+        }
+        else
+        {
+            glDeleteBuffers(1, &slot.name);
+        }
+    }
     
+    glDeleteBuffers(1, &vbo);
+    glDeleteVertexArrays(1, &vao);
+    glDeleteProgram(shaderProgram);
 }
 
 void PixelPointRenderer::loadTexture(const Image &image)
 {
-    unsigned char *texture = image.data.get();
-    int width = image.width;
-    int height = image.height;
+    // the scene always holds what is shown, so later edits to it go up over the right cells;
+    // kept edits are laid over the image as it loads
+    scene->load(image);
     
-    glBindVertexArray(vao);
+    // a luminance image is already the one byte per cell stream, or a one channel texture
+    if (scene->luminance && image.channels == 1)
+    {
+        if (mode == Mode::Texture)
+        {
+            uploadTexture(image.data.get(), image.width, image.height, image.channels);
+        }
+        else
+        {
+            uploadCells(image.data.get());
+        }
+    }
+    else
+    {
+        uploadScene();
+    }
+}
+
+void PixelPointRenderer::uploadScene()
+{
+    if (mode == Mode::Texture)
+    {
+        // the colors are an RGB image of the grid
+        uploadTexture(scene->colors.data(), scene->width, scene->height, COMPONENTS_PER_CELL);
+    }
+    else
+    {
+        uploadCells();
+    }
+}
+
+void PixelPointRenderer::loadTexture(const Scene &source)
+{
+    scene->load(source.colors.data(), source.width, source.height, COMPONENTS_PER_CELL);
+    uploadScene();
+}
+
+void PixelPointRenderer::loadScene(std::unique_ptr<Scene> next)
+{
+    // kept edits carry over to the new scene
+    if (scene->overlay && !next->overlay)
+    {
+        next->overlay = std::move(scene->overlay);
+        next->overlay->composite(next->colors.data(), next->width, next->height);
+        next->luminance = next->luminance && next->overlay->empty();
+    }
     
-    tile(texture, width, height);
+    scene = std::move(next);
+    uploadScene();
+}
+
+PixelPointRenderer::StreamSlot &PixelPointRenderer::nextSlot(bool &inFlight)
+{
+    StreamSlot &slot = slots[(currentSlot + 1) % STREAM_SLOTS];
     
-    GLfloat *vertexData = vertices.data();
-    const size_t vertexCount = vertices.size();
+    inFlight = isInFlight(slot);
+    if (slot.fence)
+    {
+        glDeleteSync(slot.fence);
+        slot.fence = 0;
+    }
     
-    glBindBuffer(GL_ARRAY_BUFFER, vbo);
-    glBufferData(GL_ARRAY_BUFFER, vertexCount * sizeof(GLfloat), vertexData, GL_DYNAMIC_DRAW);
+    if (inFlight)
+    {
+        uploads.stalls++;
+    }
     
-    //elements = elementsForTiling(width, height);
-    GLuint *elementData = elements.data();
-    const size_t elementCount = elements.size();
+    return slot;
+}
+
+bool PixelPointRenderer::isInFlight(const StreamSlot &slot) const
+{
+    // a fence that hasn't signalled yet means a draw may still be reading the slot
+    return slot.fence && glClientWaitSync(slot.fence, 0, 0) == GL_TIMEOUT_EXPIRED;
+}
+
+void PixelPointRenderer::uploadTexture(const unsigned char *data, size_t width, size_t height, int channels)
+{
+    const GLint internalFormat = channels == 1 ? GL_R8 : GL_RGB8;
+    const GLenum format = channels == 1 ? GL_RED : GL_RGB;
+    
+    bool inFlight;
+    StreamSlot &slot = nextSlot(inFlight);
+    glBindTexture(GL_TEXTURE_2D, slot.name);
     
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, elementCount * sizeof(GLuint), elementData, GL_STATIC_DRAW);
+    // rows of RGB or luminance cells aren't 4 byte aligned
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    
+    const size_t bytes = width * height * channels;
+    const bool sameSize = width == slot.width && height == slot.height && channels == slot.channels;
+    if (sameSize && !inFlight)
+    {
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, (GLsizei)width, (GLsizei)height, format, GL_UNSIGNED_BYTE, data);
+    }
+    else
+    {
+        // new storage, or respecified so the driver can hand the in flight storage off instead of waiting
+        glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, (GLsizei)width, (GLsizei)height, 0, format, GL_UNSIGNED_BYTE, data);
+    }
+    
+    if (sameSize)
+    {
+        uploads.colorUploads++;
+        uploads.colorBytes += bytes;
+    }
+    else
+    {
+        slot.width = width;
+        slot.height = height;
+        slot.channels = channels;
+        uploads.allocations++;
+        uploads.allocatedBytes += bytes;
+    }
     
-    glEnableVertexAttribArray(posAttrib);
-    glVertexAttribPointer(posAttrib, 2, GL_FLOAT, GL_FALSE, COMPONENTS_PER_VERTEX * sizeof(GLfloat), 0);
+    currentSlot = (int)(&slot - slots);
+    dirty = true;
+}
+
+void PixelPointRenderer::uploadCells(const unsigned char *luminanceCells)
+{
+    const int channels = scene->luminance ? 1 : COMPONENTS_PER_CELL;
+    const size_t cellCount = scene->width * scene->height;
+    const unsigned char *data = scene->colors.data();
+    if (channels == 1)
+    {
+        data = luminanceCells ? luminanceCells : gatherLuminance(0, cellCount);
+    }
     
-    glEnableVertexAttribArray(colAttrib);
-    glVertexAttribPointer(colAttrib, 3, GL_FLOAT, GL_FALSE, COMPONENTS_PER_VERTEX * sizeof(GLfloat), (void*)(2 * sizeof(GLfloat)));
+    bool inFlight;
+    StreamSlot &slot = nextSlot(inFlight);
     
+    glBindVertexArray(vao);
+    glBindBuffer(GL_ARRAY_BUFFER, slot.name);
     
-    //GLint texAttrib = glGetAttribLocation(shaderProgram, "texcoord");
-    //glEnableVertexAttribArray(texAttrib);
-    //glVertexAttribPointer(texAttrib, 2, GL_FLOAT, GL_FALSE, COMPONENTS_PER_VERTEX * sizeof(GLfloat), (void*)(5 * sizeof(GLfloat)));
+    const size_t bytes = cellCount * channels * sizeof(GLubyte);
+    const bool sameSize = scene->width == slot.width && scene->height == slot.height && channels == slot.channels;
+    if (sameSize && !inFlight)
+    {
+        glBufferSubData(GL_ARRAY_BUFFER, 0, bytes, data);
+    }
+    else
+    {
+        // new storage, or respecified so the driver can orphan the in flight storage instead of waiting
+        glBufferData(GL_ARRAY_BUFFER, bytes, data, GL_STREAM_DRAW);
+    }
     
-    // Load texture
-    //GLuint tex;
-    //glGenTextures(1, &tex);
-    //glBindTexture(GL_TEXTURE_2D, tex);
+    if (sameSize)
+    {
+        uploads.colorUploads++;
+        uploads.colorBytes += bytes;
+    }
+    else
+    {
+        slot.width = scene->width;
+        slot.height = scene->height;
+        slot.channels = channels;
+        uploads.allocations++;
+        uploads.allocatedBytes += bytes;
+    }
     
-    //glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, texture);
+    glVertexAttribPointer(colAttrib, channels, GL_UNSIGNED_BYTE, GL_TRUE, channels * sizeof(GLubyte), 0);
     
-    //glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    //glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-    //glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    //glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    // the whole color stream just went up, edits included
+    scene->editedRanges.clear();
+    currentSlot = (int)(&slot - slots);
+    dirty = true;
+}
+
+const unsigned char *PixelPointRenderer::gatherLuminance(size_t first, size_t count)
+{
+    // gray cells have the same value in every component
+    luminanceCells.resize(count);
+    const unsigned char *cell = &scene->colors[first * COMPONENTS_PER_CELL];
+    for (size_t i = 0; i < count; i++, cell += COMPONENTS_PER_CELL)
+    {
+        luminanceCells[i] = cell[0];
+    }
+    return luminanceCells.data();
 }
 
 void PixelPointRenderer::clear()
 {
-    Quad::clear();
+    scene->clear();
+    
+    // nothing is drawn until the next image comes in
+    currentSlot = -1;
+    dirty = true;
+}
+
+void PixelPointRenderer::flushEdits()
+{
+    std::vector<Scene::CellRange> &editedRanges = scene->editedRanges;
+    const std::vector<unsigned char> &colors = scene->colors;
+    if (editedRanges.empty())
+    {
+        return;
+    }
+    
+    // there has to be a slot holding the grid
+    if (currentSlot < 0)
+    {
+        editedRanges.clear();
+        return;
+    }
+    
+    if (mode == Mode::Texture)
+    {
+        flushTextureEdits();
+        return;
+    }
+    
+    // an edit that left a luminance grid with other colors needs all three bytes of every cell
+    const int channels = scene->luminance ? 1 : COMPONENTS_PER_CELL;
+    if (slots[currentSlot].channels != channels)
+    {
+        uploadCells();
+        return;
+    }
+    
+    // edits are written into the slot the last frame drew from. while that draw is still
+    // reading it, the whole stream goes to the next slot instead of waiting on the GPU
+    if (isInFlight(slots[currentSlot]))
+    {
+        uploads.stalls++;
+        uploadCells();
+        return;
+    }
+    
+    std::sort(editedRanges.begin(), editedRanges.end(), [](const Scene::CellRange &a, const Scene::CellRange &b)
+    {
+        return a.first < b.first;
+    });
+    
+    // the grid may have shrunk since the edit was made
+    const size_t cellCount = colors.size() / COMPONENTS_PER_CELL;
+    
+    glBindBuffer(GL_ARRAY_BUFFER, slots[currentSlot].name);
+    
+    size_t i = 0;
+    while (i < editedRanges.size() && editedRanges[i].first < cellCount)
+    {
+        const size_t first = editedRanges[i].first;
+        size_t last = editedRanges[i].last;
+        while (++i < editedRanges.size() && editedRanges[i].first <= last + EDIT_MERGE_GAP + 1)
+        {
+            last = std::max(last, editedRanges[i].last);
+        }
+        last = std::min(last, cellCount - 1);
+        
+        const size_t offset = first * channels;
+        const size_t bytes = (last - first + 1) * channels * sizeof(GLubyte);
+        const unsigned char *data = channels == 1 ? gatherLuminance(first, last - first + 1) : &colors[offset];
+        glBufferSubData(GL_ARRAY_BUFFER, offset * sizeof(GLubyte), bytes, data);
+        uploads.editUploads++;
+        uploads.editBytes += bytes;
+    }
+    
+    editedRanges.clear();
+}
+
+void PixelPointRenderer::flushTextureEdits()
+{
+    std::vector<Scene::CellRange> &editedRanges = scene->editedRanges;
+    StreamSlot &slot = slots[currentSlot];
+    
+    // the texture has to be the scene's RGB grid for rows of it to be replaced; a luminance
+    // image or a different size goes up whole. so does everything while the last draw from the
+    // slot is still reading it
+    const bool matches = slot.width == scene->width && slot.height == scene->height && slot.channels == COMPONENTS_PER_CELL;
+    const bool inFlight = matches && isInFlight(slot);
+    if (!matches || inFlight)
+    {
+        if (inFlight)
+        {
+            uploads.stalls++;
+        }
+        uploadScene();
+        editedRanges.clear();
+        return;
+    }
+    
+    std::sort(editedRanges.begin(), editedRanges.end(), [](const Scene::CellRange &a, const Scene::CellRange &b)
+    {
+        return a.first < b.first;
+    });
+    
+    glBindTexture(GL_TEXTURE_2D, slot.name);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    
+    // edits become spans of whole rows; ranges on the same or neighbouring rows go up together
+    const size_t width = scene->width;
+    const size_t rowBytes = width * COMPONENTS_PER_CELL * sizeof(GLubyte);
+    size_t i = 0;
+    while (i < editedRanges.size() && editedRanges[i].first < scene->width * scene->height)
+    {
+        const size_t top = editedRanges[i].first / width;
+        size_t bottom = editedRanges[i].last / width;
+        while (++i < editedRanges.size() && editedRanges[i].first / width <= bottom + 1)
+        {
+            bottom = std::max(bottom, editedRanges[i].last / width);
+        }
+        bottom = std::min(bottom, scene->height - 1);
+        
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, (GLint)top, (GLsizei)width, (GLsizei)(bottom - top + 1), GL_RGB, GL_UNSIGNED_BYTE, &scene->colors[top * rowBytes]);
+        uploads.editUploads++;
+        uploads.editBytes += (bottom - top + 1) * rowBytes;
+    }
+    
+    editedRanges.clear();
+}
+
+bool PixelPointRenderer::needsDisplay() const
+{
+    return dirty || !scene->editedRanges.empty() || rotation != transformRotation || flip[0] != transformFlip[0] || flip[1] != transformFlip[1];
+}
+
+void PixelPointRenderer::setNeedsDisplay()
+{
+    dirty = true;
+}
+
+bool PixelPointRenderer::renderIfNeeded()
+{
+    if (!needsDisplay())
+    {
+        framesSkipped++;
+        return false;
+    }
+    
+    render();
+    return true;
 }
 
 void PixelPointRenderer::render()
 {
+    dirty = false;
+    framesRendered++;
+    
     glUseProgram(shaderProgram);
     glBindVertexArray(vao);
     
-    float xScale = flip[0] ? -1.0f : 1.0f;
-    float yScale = flip[1] ? -1.0f : 1.0f;
-    float flip [] = { xScale, 0, 0, yScale };
-    float rotate [] = { std::cos(rotation), -std::sin(rotation), sin(rotation), std::cos(rotation)};
-    float transform[] = {flip[0]*rotate[0] + flip[1]*rotate[2], flip[0]*rotate[1] + flip[1]*rotate[3], flip[2]*rotate[0] + flip[3]*rotate[2], flip[2]*rotate[1] + flip[3]*rotate[3]};
+    flushEdits();
     
-    GLuint transformID = glGetUniformLocation(shaderProgram, "transformation");
-    glUniformMatrix2fv(transformID, 1, GL_FALSE, &transform[0]);
+    if (rotation != transformRotation || flip[0] != transformFlip[0] || flip[1] != transformFlip[1])
+    {
+        float xScale = flip[0] ? -1.0f : 1.0f;
+        float yScale = flip[1] ? -1.0f : 1.0f;
+        float flip [] = { xScale, 0, 0, yScale };
+        float rotate [] = { std::cos(rotation), -std::sin(rotation), std::sin(rotation), std::cos(rotation)};
+        transform[0] = flip[0]*rotate[0] + flip[1]*rotate[2];
+        transform[1] = flip[0]*rotate[1] + flip[1]*rotate[3];
+        transform[2] = flip[2]*rotate[0] + flip[3]*rotate[2];
+        transform[3] = flip[2]*rotate[1] + flip[3]*rotate[3];
+        
+        transformRotation = rotation;
+        transformFlip[0] = this->flip[0];
+        transformFlip[1] = this->flip[1];
+    }
+    
+    glUniformMatrix2fv(transformUniform, 1, GL_FALSE, &transform[0]);
     
     // Clear the screen to black
     glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
     glClear(GL_COLOR_BUFFER_BIT);
     
-    // Draw a rectangle from the 2 triangles using 6 indices
-    glDrawElements(GL_TRIANGLES, (int)elements.size(), GL_UNSIGNED_INT, 0);
+    if (currentSlot < 0)
+    {
+        return;
+    }
+    
+    StreamSlot &slot = slots[currentSlot];
+    glUniform1i(luminanceUniform, slot.channels == 1);
+    if (mode == Mode::Texture)
+    {
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, slot.name);
+        
+        // the whole image is one rectangle from 2 triangles
+        glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+    }
+    else
+    {
+        // Draw every cell as a 2 triangle strip
+        glUniform2i(gridSizeUniform, (GLint)scene->width, (GLint)scene->height);
+        glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, (GLsizei)(scene->colors.size() / COMPONENTS_PER_CELL));
+    }
+    
+    // lets the next upload to this slot tell whether the draw is done with it
+    if (slot.fence)
+    {
+        glDeleteSync(slot.fence);
+    }
+    slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
 }
@@ -12,6 +12,7 @@
 #include "Color.h"
 #include "Quad.h"
 #include "Image.h"
+#include "Palette.h"
 
 #import <OpenGL/OpenGL.h>
 #include <OpenGL/gl3.h>
@@ -19,6 +20,9 @@
 
 #define SUPPORT_RETINA_RESOLUTION 1
 
+static const size_t PALETTE_COLORS = 16;
+static const Dither::Mode PALETTE_DITHER = Dither::Mode::FloydSteinberg;
+
 @interface PixelPointView ()
 {
     PixelPointRenderer* _renderer;
@@ -107,11 +111,13 @@ struct free_delete
         NSURL *imageUrl = [[panel URLs] objectAtIndex:0];
         NSString *filePath = [imageUrl relativePath];
         
-        Image soilImage = Image::loadImage([filePath UTF8String]);
-        Image scaledImage = Image::scaledFromSource(soilImage);
+        Image scaledImage = Image::loadScaledImage([filePath UTF8String]);
         
         _renderer->loadTexture(scaledImage);
         
+        // strokes finished within a third of a second of each other undo together
+        _renderer->scene->enableJournal({64 * 1024 * 1024, 0.3});
+        
         NSRect viewFrame = self.frame;
         viewFrame.size.width = scaledImage.width * 16;
         viewFrame.size.height = scaledImage.height * 16;
@@ -213,6 +219,12 @@ struct free_delete
    // [_renderer resizeWithWidth:viewRectPixels.size.width
       //               AndHeight:viewRectPixels.size.height];
     
+    // the viewport changed, so the next display link frame has to draw
+    if (_renderer)
+    {
+        _renderer->setNeedsDisplay();
+    }
+    
     CGLUnlockContext([[self openGLContext] CGLContextObj]);
 }
 
@@ -236,6 +248,7 @@ struct free_delete
     // Called during resize operations
     
     // Avoid flickering during resize by drawiing
+    _renderer->setNeedsDisplay();
     [self drawView];
 }
 
@@ -249,9 +262,12 @@ struct free_delete
     // simultaneously when resizing
     CGLLockContext([[self openGLContext] CGLContextObj]);
     
-    _renderer->render();
+    // the display link fires every refresh; when nothing changed the last frame is still on screen
+    if (_renderer->renderIfNeeded())
+    {
+        CGLFlushDrawable([[self openGLContext] CGLContextObj]);
+    }
     
-    CGLFlushDrawable([[self openGLContext] CGLContextObj]);
     CGLUnlockContext([[self openGLContext] CGLContextObj]);
 }
 
@@ -286,6 +302,7 @@ struct free_delete
 }
 
 static Quad mouseDownLocation;
+static Quad lastDragLocation;
 
 - (NSPoint)screenToOpenGLCoordinates: (NSPoint) point
 {
@@ -302,34 +319,118 @@ static Quad mouseDownLocation;
 {
     NSPoint mouseLocation = [self screenToOpenGLCoordinates: [event locationInWindow]];
     float point [] = {(float)mouseLocation.x, (float)mouseLocation.y};
-    for (Quad quad : Quad::quads)
+    
+    // the scene can be swapped or resized by a load on the display link thread
+    CGLLockContext([[self openGLContext] CGLContextObj]);
+    mouseDownLocation = _renderer->scene->quadAt(point);
+    CGLUnlockContext([[self openGLContext] CGLContextObj]);
+    lastDragLocation = mouseDownLocation;
+}
+
+- (void)mouseUp:(NSEvent *)event
+{
+    NSPoint mouseLocation = [self screenToOpenGLCoordinates: [event locationInWindow]];
+    float point [] = {(float)mouseLocation.x, (float)mouseLocation.y};
+    
+    // the edit is picked up and uploaded by the next display link frame
+    CGLLockContext([[self openGLContext] CGLContextObj]);
+    Quad quad = _renderer->scene->quadAt(point);
+    if (quad.isValid() && mouseDownLocation == quad)
     {
-        if (Quad::isPointInQuad(quad, point))
+        if ([event modifierFlags] & NSEventModifierFlagOption)
         {
-            mouseDownLocation = quad;
-            break;
+            // option click fills the whole area of the clicked color
+            _renderer->scene->floodFill(quad.index(), Color(0, 0, 0));
         }
+        else
+        {
+            quad.setColorToBlack();
+        }
+    }
+    
+    // the click or drag stroke is one step of undo
+    if (_renderer->scene->journal)
+    {
+        _renderer->scene->journal->commit(*_renderer->scene, [event timestamp]);
     }
+    CGLUnlockContext([[self openGLContext] CGLContextObj]);
 }
 
-- (void)mouseUp:(NSEvent *)event
+- (void)mouseDragged:(NSEvent *)event
 {
+    // paint every cell the drag passes over, the renderer batches the edits into a few uploads per frame.
+    // drag events can skip cells when the mouse moves fast, so draw a line from the last one
     NSPoint mouseLocation = [self screenToOpenGLCoordinates: [event locationInWindow]];
     float point [] = {(float)mouseLocation.x, (float)mouseLocation.y};
-    for (Quad quad : Quad::quads)
+    
+    CGLLockContext([[self openGLContext] CGLContextObj]);
+    Scene &scene = *_renderer->scene;
+    const Quad quad = scene.quadAt(point);
+    if (quad.isValid())
+    {
+        const Quad from = lastDragLocation.isValid() ? lastDragLocation : quad;
+        scene.drawLine(from.index() % scene.width, from.index() / scene.width, quad.index() % scene.width, quad.index() / scene.width, Color(0, 0, 0));
+        lastDragLocation = quad;
+    }
+    CGLUnlockContext([[self openGLContext] CGLContextObj]);
+}
+
+- (BOOL)acceptsFirstResponder
+{
+    return YES;
+}
+
+- (void)keyDown:(NSEvent *)event
+{
+    // P reduces the image to a small dithered palette, as one step of undo
+    if ([[event charactersIgnoringModifiers] isEqualToString:@"p"])
     {
-        if (Quad::isPointInQuad(quad, point))
+        CGLLockContext([[self openGLContext] CGLContextObj]);
+        Scene &scene = *_renderer->scene;
+        scene.reduceTo(Palette::kMeans(scene.colors.data(), scene.width * scene.height, Scene::COMPONENTS_PER_CELL, PALETTE_COLORS), PALETTE_DITHER);
+        if (scene.journal)
         {
-            if (mouseDownLocation == quad)
-            {
-                [[self openGLContext] makeCurrentContext];
-                quad.setColorToBlack();
-                
-                [self setNeedsDisplay:YES];
-            }
-            break;
+            scene.journal->commit(scene, [event timestamp]);
         }
+        CGLUnlockContext([[self openGLContext] CGLContextObj]);
+        return;
+    }
+    
+    [super keyDown:event];
+}
+
+- (IBAction)undo:(id)sender
+{
+    CGLLockContext([[self openGLContext] CGLContextObj]);
+    if (_renderer->scene->journal)
+    {
+        _renderer->scene->journal->undo(*_renderer->scene);
+    }
+    CGLUnlockContext([[self openGLContext] CGLContextObj]);
+}
+
+- (IBAction)redo:(id)sender
+{
+    CGLLockContext([[self openGLContext] CGLContextObj]);
+    if (_renderer->scene->journal)
+    {
+        _renderer->scene->journal->redo(*_renderer->scene);
+    }
+    CGLUnlockContext([[self openGLContext] CGLContextObj]);
+}
+
+- (BOOL)validateMenuItem:(NSMenuItem *)menuItem
+{
+    const EditJournal *journal = _renderer ? _renderer->scene->journal.get() : nullptr;
+    if ([menuItem action] == @selector(undo:))
+    {
+        return journal && journal->canUndo();
+    }
+    if ([menuItem action] == @selector(redo:))
+    {
+        return journal && journal->canRedo();
     }
+    return [super validateMenuItem:menuItem];
 }
 
 @end
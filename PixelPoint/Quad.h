@@ -14,37 +14,46 @@
 #include <stdio.h>
 #include <vector>
 
+struct Scene;
+
 struct Quad
 {
     Quad()
     {
-        vertexOffset = -1;
-        elementOffset = -1;
+        scene = nullptr;
+        cell = -1;
     }
-    Quad (float topLeft[2], float bottomRight[2], Color);
+    Quad (Scene *scene, size_t cell);
     ~Quad();
     
-    float topLeft() const;
-    float bottomRight() const;
-    
     Color color() const;
     
+    // the cell in row order, so x is index() % width and y is index() / width
+    size_t index() const
+    {
+        return cell;
+    }
+    
+    // false for the default handle, which hit tests return for points off the grid
+    bool isValid() const
+    {
+        return scene != nullptr;
+    }
+    
     static bool isPointInQuad(const Quad &quad, float point[2]);
     
+    void setColor(const Color &color);
     void setColorToBlack();
     
-    static std::vector<Quad> quads;
-    
     friend bool operator==(const Quad &lhs, const Quad &rhs)
     {
-        return lhs.vertexOffset == rhs.vertexOffset;
+        return lhs.scene == rhs.scene && lhs.cell == rhs.cell;
     }
     
-    static void clear();
-    
 private:
-    size_t vertexOffset;
-    size_t elementOffset;
+    // index into the scene's grid, in row order
+    Scene *scene;
+    size_t cell;
 };
 
 #endif /* Quad_hpp */
@@ -0,0 +1,501 @@
+//
+//  Scene.cpp
+//  PixelPoint
+//
+//  Created by Kelsey Steeves on 2026-10-19.
+//  Copyright © 2026 Kelsey Steeves. All rights reserved.
+//
+
+#include "Scene.h"
+
+#include "PaletteTable.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+
+Scene::Scene()
+: width(0), height(0), luminance(false)
+{
+}
+
+bool Scene::load(const Image &image)
+{
+    return load(image.data.get(), image.width, image.height, image.channels);
+}
+
+bool Scene::load(const unsigned char *data, size_t width, size_t height, int channels)
+{
+    const size_t cellCount = width * height;
+    const bool resized = width != this->width || height != this->height;
+    
+    // storage is kept between grids so only growing allocates
+    if (resized)
+    {
+        this->width = width;
+        this->height = height;
+        colors.resize(cellCount * COMPONENTS_PER_CELL);
+    }
+    
+    generateColors(data, cellCount, channels, colors.data());
+    luminance = channels == 1 && (!overlay || overlay->empty());
+    if (overlay)
+    {
+        overlay->composite(colors.data(), width, height);
+    }
+    
+    // every cell was just replaced, edits included
+    editedRanges.clear();
+    if (journal)
+    {
+        journal->reset(*this);
+    }
+    
+    return resized;
+}
+
+void Scene::clear()
+{
+    width = 0;
+    height = 0;
+    colors.clear();
+    luminance = false;
+    editedRanges.clear();
+    if (journal)
+    {
+        journal->reset(*this);
+    }
+}
+
+void Scene::enableJournal(const EditJournal::Limits &limits)
+{
+    journal.reset(new EditJournal(*this, limits));
+}
+
+void Scene::enableOverlay()
+{
+    if (!overlay)
+    {
+        overlay.reset(new EditOverlay());
+    }
+}
+
+// the first of count cells along an axis whose edges, computed the way the shader places them,
+// hold the position, or -1. start is the cell at position 0 and step the signed cell size
+static long cellAlongAxis(float position, size_t count, float start, float step)
+{
+    if (count == 0)
+    {
+        return -1;
+    }
+    
+    // the arithmetic guess can be a cell off where rounding moves a position across an edge
+    // (or a position on an edge belongs to the earlier cell), so settle it with the edges themselves
+    const long guess = (long)std::floor((position - start) / step);
+    const long first = std::max(guess - 1, 0L);
+    const long last = std::min(guess + 1, (long)count - 1);
+    for (long cell = first; cell <= last; cell++)
+    {
+        const float near = start + cell * step;
+        const float far = near + step;
+        if (std::min(near, far) <= position && std::max(near, far) >= position)
+        {
+            return cell;
+        }
+    }
+    
+    return -1;
+}
+
+Quad Scene::quadAt(const float point[2])
+{
+    const long column = cellAlongAxis(point[0], width, -1.0f, 2.0f / width);
+    const long row = cellAlongAxis(point[1], height, 1.0f, -2.0f / height);
+    if (column < 0 || row < 0)
+    {
+        return Quad();
+    }
+    
+    return quad(row * width + column);
+}
+
+Quad Scene::quad(size_t cell)
+{
+    return Quad(this, cell);
+}
+
+Color Scene::colorAt(size_t cell) const
+{
+    const size_t offset = cell * COMPONENTS_PER_CELL;
+    return Color(colors.at(offset), colors.at(offset + 1), colors.at(offset + 2));
+}
+
+void Scene::editCell(size_t cell, const Color &color)
+{
+    const size_t offset = cell * COMPONENTS_PER_CELL;
+    colors.at(offset) = color.red;
+    colors.at(offset + 1) = color.green;
+    colors.at(offset + 2) = color.blue;
+    
+    markEdited(cell, cell);
+    noteWritten(cell, cell);
+}
+
+void Scene::fill(const Color &color)
+{
+    fillRect(0, 0, width, height, color);
+}
+
+void Scene::fillRect(size_t x, size_t y, size_t width, size_t height, const Color &color)
+{
+    if (x >= this->width || y >= this->height)
+    {
+        return;
+    }
+    
+    width = std::min(width, this->width - x);
+    height = std::min(height, this->height - y);
+    if (width == 0 || height == 0)
+    {
+        return;
+    }
+    
+    const unsigned char rgb[COMPONENTS_PER_CELL] = {color.red, color.green, color.blue};
+    for (size_t row = y; row < y + height; row++)
+    {
+        const size_t first = row * this->width + x;
+        unsigned char *cell = &colors[first * COMPONENTS_PER_CELL];
+        for (size_t i = 0; i < width; i++, cell += COMPONENTS_PER_CELL)
+        {
+            cell[0] = rgb[0];
+            cell[1] = rgb[1];
+            cell[2] = rgb[2];
+        }
+        noteWritten(first, first + width - 1);
+    }
+    
+    markEdited(y * this->width + x, (y + height - 1) * this->width + x + width - 1);
+}
+
+size_t Scene::recolor(const Color &from, const Color &to)
+{
+    const unsigned char match[COMPONENTS_PER_CELL] = {from.red, from.green, from.blue};
+    const unsigned char rgb[COMPONENTS_PER_CELL] = {to.red, to.green, to.blue};
+    
+    size_t changed = 0;
+    size_t first = -1;
+    size_t last = 0;
+    unsigned char *cell = colors.data();
+    const size_t cellCount = width * height;
+    for (size_t i = 0; i < cellCount; i++, cell += COMPONENTS_PER_CELL)
+    {
+        if (cell[0] == match[0] && cell[1] == match[1] && cell[2] == match[2])
+        {
+            cell[0] = rgb[0];
+            cell[1] = rgb[1];
+            cell[2] = rgb[2];
+            noteWritten(i, i);
+            first = std::min(first, i);
+            last = i;
+            changed++;
+        }
+    }
+    
+    if (changed)
+    {
+        markEdited(first, last);
+    }
+    
+    return changed;
+}
+
+size_t Scene::reduceTo(const Palette &palette, Dither::Mode dither)
+{
+    const size_t cellCount = width * height;
+    if (palette.empty() || cellCount == 0)
+    {
+        return 0;
+    }
+    
+    std::vector<unsigned char> reduced(colors);
+    Dither::apply(dither, *PaletteTable::forPalette(palette), reduced.data(), width, height);
+    
+    size_t changed = 0;
+    size_t first = -1;
+    size_t last = 0;
+    unsigned char *cell = colors.data();
+    const unsigned char *color = reduced.data();
+    for (size_t i = 0; i < cellCount; i++, cell += COMPONENTS_PER_CELL, color += COMPONENTS_PER_CELL)
+    {
+        if (cell[0] != color[0] || cell[1] != color[1] || cell[2] != color[2])
+        {
+            cell[0] = color[0];
+            cell[1] = color[1];
+            cell[2] = color[2];
+            noteWritten(i, i);
+            first = std::min(first, i);
+            last = i;
+            changed++;
+        }
+    }
+    
+    if (changed)
+    {
+        markEdited(first, last);
+    }
+    
+    return changed;
+}
+
+void Scene::copyRegion(const Scene &source, size_t sourceX, size_t sourceY, size_t width, size_t height, size_t x, size_t y)
+{
+    if (sourceX >= source.width || sourceY >= source.height || x >= this->width || y >= this->height)
+    {
+        return;
+    }
+    
+    width = std::min(width, std::min(source.width - sourceX, this->width - x));
+    height = std::min(height, std::min(source.height - sourceY, this->height - y));
+    if (width == 0 || height == 0)
+    {
+        return;
+    }
+    
+    // copying within this scene to a lower row has to go bottom up so rows are read before
+    // they are overwritten; memmove takes care of overlap within a row
+    const bool bottomUp = &source == this && y > sourceY;
+    const size_t bytes = width * COMPONENTS_PER_CELL;
+    for (size_t i = 0; i < height; i++)
+    {
+        const size_t row = bottomUp ? height - 1 - i : i;
+        const size_t from = (sourceY + row) * source.width + sourceX;
+        const size_t to = (y + row) * this->width + x;
+        memmove(&colors[to * COMPONENTS_PER_CELL], &source.colors[from * COMPONENTS_PER_CELL], bytes);
+        noteWritten(to, to + width - 1);
+    }
+    
+    markEdited(y * this->width + x, (y + height - 1) * this->width + x + width - 1);
+}
+
+size_t Scene::floodFill(size_t cell, const Color &color)
+{
+    if (cell >= width * height)
+    {
+        return 0;
+    }
+    
+    unsigned char *data = colors.data();
+    const unsigned char *start = data + cell * COMPONENTS_PER_CELL;
+    const unsigned char match[COMPONENTS_PER_CELL] = {start[0], start[1], start[2]};
+    const unsigned char rgb[COMPONENTS_PER_CELL] = {color.red, color.green, color.blue};
+    if (memcmp(match, rgb, COMPONENTS_PER_CELL) == 0)
+    {
+        return 0;
+    }
+    
+    auto matches = [&](size_t i)
+    {
+        const unsigned char *c = data + i * COMPONENTS_PER_CELL;
+        return c[0] == match[0] && c[1] == match[1] && c[2] == match[2];
+    };
+    
+    // queues the first cell of every matching run in a row, between two columns
+    auto seedRow = [&](size_t row, size_t left, size_t right)
+    {
+        bool inRun = false;
+        for (size_t i = row * width + left; i <= row * width + right; i++)
+        {
+            const bool match = matches(i);
+            if (match && !inRun)
+            {
+                fillStack.push_back(i);
+            }
+            inRun = match;
+        }
+    };
+    
+    size_t changed = 0;
+    size_t first = cell;
+    size_t last = cell;
+    
+    fillStack.clear();
+    fillStack.push_back(cell);
+    while (!fillStack.empty())
+    {
+        const size_t seed = fillStack.back();
+        fillStack.pop_back();
+        if (!matches(seed))
+        {
+            continue;
+        }
+        
+        // widen the seed to the whole matching span in its row, then fill the span in one pass
+        const size_t row = seed / width;
+        const size_t rowStart = row * width;
+        size_t left = seed;
+        size_t right = seed;
+        while (left > rowStart && matches(left - 1))
+        {
+            left--;
+        }
+        while (right + 1 < rowStart + width && matches(right + 1))
+        {
+            right++;
+        }
+        
+        unsigned char *c = data + left * COMPONENTS_PER_CELL;
+        for (size_t i = left; i <= right; i++, c += COMPONENTS_PER_CELL)
+        {
+            c[0] = rgb[0];
+            c[1] = rgb[1];
+            c[2] = rgb[2];
+        }
+        noteWritten(left, right);
+        changed += right - left + 1;
+        first = std::min(first, left);
+        last = std::max(last, right);
+        
+        if (row > 0)
+        {
+            seedRow(row - 1, left - rowStart, right - rowStart);
+        }
+        if (row + 1 < height)
+        {
+            seedRow(row + 1, left - rowStart, right - rowStart);
+        }
+    }
+    
+    markEdited(first, last);
+    return changed;
+}
+
+void Scene::drawLine(long x0, long y0, long x1, long y1, const Color &color)
+{
+    const unsigned char rgb[COMPONENTS_PER_CELL] = {color.red, color.green, color.blue};
+    
+    const long dx = std::abs(x1 - x0);
+    const long dy = -std::abs(y1 - y0);
+    const long stepX = x0 < x1 ? 1 : -1;
+    const long stepY = y0 < y1 ? 1 : -1;
+    long error = dx + dy;
+    
+    size_t first = -1;
+    size_t last = 0;
+    for (;;)
+    {
+        if (x0 >= 0 && y0 >= 0 && (size_t)x0 < width && (size_t)y0 < height)
+        {
+            const size_t cell = y0 * width + x0;
+            unsigned char *c = &colors[cell * COMPONENTS_PER_CELL];
+            c[0] = rgb[0];
+            c[1] = rgb[1];
+            c[2] = rgb[2];
+            noteWritten(cell, cell);
+            first = std::min(first, cell);
+            last = std::max(last, cell);
+        }
+        
+        if (x0 == x1 && y0 == y1)
+        {
+            break;
+        }
+        
+        const long doubled = 2 * error;
+        if (doubled >= dy)
+        {
+            error += dy;
+            x0 += stepX;
+        }
+        if (doubled <= dx)
+        {
+            error += dx;
+            y0 += stepY;
+        }
+    }
+    
+    if (first <= last)
+    {
+        markEdited(first, last);
+    }
+}
+
+void Scene::noteWritten(size_t first, size_t last)
+{
+    if (journal)
+    {
+        journal->touched(first, last);
+    }
+    keepInOverlay(first, last);
+}
+
+void Scene::keepInOverlay(size_t first, size_t last)
+{
+    if (overlay)
+    {
+        overlay->record(colors.data(), width, height, first, last);
+    }
+}
+
+void Scene::markEdited(size_t first, size_t last)
+{
+    // only the cells in the range can have stopped being gray
+    if (luminance)
+    {
+        luminance = isGray(first, last);
+    }
+    
+    // strokes, rows and full width rects mostly continue the last range
+    if (!editedRanges.empty())
+    {
+        CellRange &previous = editedRanges.back();
+        if (first <= previous.last + 1 && last + 1 >= previous.first)
+        {
+            previous.first = std::min(previous.first, first);
+            previous.last = std::max(previous.last, last);
+            return;
+        }
+    }
+    
+    editedRanges.push_back({first, last});
+}
+
+bool Scene::isGray(size_t first, size_t last) const
+{
+    const unsigned char *cell = &colors[first * COMPONENTS_PER_CELL];
+    for (size_t i = first; i <= last; i++, cell += COMPONENTS_PER_CELL)
+    {
+        if (cell[0] != cell[1] || cell[0] != cell[2])
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+void Scene::generateColors(const unsigned char *texture, size_t cellCount, int channels, unsigned char *colors)
+{
+    // RGB images are already laid out like the stream
+    if (channels == COMPONENTS_PER_CELL)
+    {
+        memcpy(colors, texture, cellCount * COMPONENTS_PER_CELL);
+        return;
+    }
+    
+    // luminance images have one byte per cell, used for all three components
+    if (channels == 1)
+    {
+        for (size_t i = 0; i < cellCount; i++, colors += COMPONENTS_PER_CELL)
+        {
+            colors[0] = colors[1] = colors[2] = texture[i];
+        }
+        return;
+    }
+    
+    for (size_t i = 0; i < cellCount; i++, texture += channels, colors += COMPONENTS_PER_CELL)
+    {
+        colors[0] = texture[0];
+        colors[1] = texture[1];
+        colors[2] = texture[2];
+    }
+}
@@ -0,0 +1,122 @@
+//
+//  Scene.hpp
+//  PixelPoint
+//
+//  Created by Kelsey Steeves on 2026-10-19.
+//  Copyright © 2026 Kelsey Steeves. All rights reserved.
+//
+
+#ifndef Scene_hpp
+#define Scene_hpp
+
+#include "Color.h"
+#include "Dither.h"
+#include "EditJournal.h"
+#include "EditOverlay.h"
+#include "Image.h"
+#include "Palette.h"
+#include "Quad.h"
+
+#include <memory>
+#include <vector>
+
+// the grid of cells a renderer draws: one RGB color per cell in row order. Quad handles to hit
+// test and edit cells are made on demand. the colors are the only copy of the grid's content; GPU
+// buffers are uploaded from them, and edits go through the scene so it knows what to re-upload.
+// a scene is plain CPU data owned by one renderer, so several renderers can work side by side
+// and the next scene can be built on another thread while the current one is drawn. Quads point
+// back at their scene, so scenes stay put once created
+struct Scene
+{
+    static const int COMPONENTS_PER_CELL = 3;
+    
+    Scene();
+    Scene(const Scene &) = delete;
+    Scene &operator=(const Scene &) = delete;
+    
+    // fills the colors from an RGB(A) or luminance image, resizing them only when the grid size
+    // changes, then lays the overlay's edits over them. returns whether it resized
+    bool load(const Image &image);
+    bool load(const unsigned char *data, size_t width, size_t height, int channels);
+    void clear();
+    
+    // the cell under a point in grid space (GL coordinates before the renderer's rotation and
+    // flip), or an invalid Quad outside the grid. found arithmetically, so it costs the same on
+    // any grid
+    Quad quadAt(const float point[2]);
+    Quad quad(size_t cell);
+    
+    Color colorAt(size_t cell) const;
+    
+    // recolors a cell; the edit is remembered until the renderer uploads it
+    void editCell(size_t cell, const Color &color);
+    
+    // bulk edits run over whole rows of contiguous colors, so they cost what they touch. each is
+    // remembered as the one range of cells between the first and last it changed, so it goes up
+    // in a single upload. regions are clipped to the grid
+    void fill(const Color &color);
+    void fillRect(size_t x, size_t y, size_t width, size_t height, const Color &color);
+    
+    // replaces every cell of one color with another, returning how many changed
+    size_t recolor(const Color &from, const Color &to);
+    
+    // replaces every cell with a palette color, its nearest or a dithered one, returning how
+    // many changed
+    size_t reduceTo(const Palette &palette, Dither::Mode dither = Dither::Mode::None);
+    
+    // copies a region of another scene (or this one, overlaps included) to x, y
+    void copyRegion(const Scene &source, size_t sourceX, size_t sourceY, size_t width, size_t height, size_t x, size_t y);
+    
+    // recolors the 4-connected area of cells matching the color of the start cell, a row span at
+    // a time, returning how many changed
+    size_t floodFill(size_t cell, const Color &color);
+    
+    // colors the cells a Bresenham line between two cells passes through. ends may be off the
+    // grid; only the cells on it are drawn
+    void drawLine(long x0, long y0, long x1, long y1, const Color &color);
+    
+    // fills an RGB per cell color stream in one linear pass
+    static void generateColors(const unsigned char *texture, size_t cellCount, int channels, unsigned char *colors);
+    
+    size_t width;
+    size_t height;
+    std::vector<unsigned char> colors;
+    
+    // every cell is gray, as when loaded from a luminance image with no kept edits over it. the
+    // renderer then sends one byte per cell instead of three. an edit that writes any other
+    // color clears it
+    bool luminance;
+    
+    // inclusive runs of cells edited since the last upload, in edit order. may overlap
+    struct CellRange
+    {
+        size_t first;
+        size_t last;
+    };
+    std::vector<CellRange> editedRanges;
+    
+    // undo history, off unless enabled. loading a new image starts it over
+    void enableJournal(const EditJournal::Limits &limits);
+    std::unique_ptr<EditJournal> journal;
+    
+    // edits to keep over every image loaded after them, off unless enabled. clear keeps it
+    void enableOverlay();
+    std::unique_ptr<EditOverlay> overlay;
+    
+private:
+    friend class EditJournal;
+    
+    // queues cells for upload. bulk edits queue the one range around everything they wrote
+    void markEdited(size_t first, size_t last);
+    bool isGray(size_t first, size_t last) const;
+    
+    // tells the journal exactly which cells an edit wrote, so a commit only compares those,
+    // and keeps them in the overlay
+    void noteWritten(size_t first, size_t last);
+    void keepInOverlay(size_t first, size_t last);
+    
+    // seeds waiting to be filled, kept between fills
+    std::vector<size_t> fillStack;
+};
+
+#endif /* Scene_hpp */
@@ -0,0 +1,88 @@
+//
+//  DitherTests.mm
+//  PixelPointTests
+//
+//  Created by Kelsey Steeves on 2026-10-19.
+//  Copyright © 2026 Kelsey Steeves. All rights reserved.
+//
+
+#import <XCTest/XCTest.h>
+
+#include "Dither.h"
+
+#include <cstdlib>
+#include <vector>
+
+static const size_t WIDTH = 301;
+static const size_t HEIGHT = 97;
+
+// smooth ramps with some noise on top, so every cell lands between palette colors and carries
+// error on to the cells after it
+static std::vector<unsigned char> rampGrid(size_t width, size_t height)
+{
+    std::vector<unsigned char> colors(width * height * 3);
+    srand(49);
+    for (size_t y = 0; y < height; y++)
+    {
+        for (size_t x = 0; x < width; x++)
+        {
+            unsigned char *cell = &colors[(y * width + x) * 3];
+            cell[0] = (unsigned char)(x * 255 / width);
+            cell[1] = (unsigned char)(y * 255 / height);
+            cell[2] = (unsigned char)((x + y + rand() % 24) * 255 / (width + height + 24));
+        }
+    }
+    return colors;
+}
+
+static Palette rampPalette()
+{
+    std::vector<Color> colors;
+    for (int i = 0; i < 12; i++)
+    {
+        colors.push_back(Color(i * 23, 255 - i * 19, (i * 97) & 0xff));
+    }
+    return Palette(colors);
+}
+
+@interface DitherTests : XCTestCase
+
+@end
+
+@implementation DitherTests
+
+// splitting rows across threads must not change a single cell: the wavefront only lets a row
+// past a cell once the row above has finished everything that cell is owed from. the grid is
+// well under PARALLEL_CELLS, so the thread counts are asked for outright, and include more
+// threads than a few rows and a count the rows don't divide by
+- (void)testThreadedMatchesSingleThread
+{
+    const std::shared_ptr<const PaletteTable> table = PaletteTable::forPalette(rampPalette());
+    const std::vector<unsigned char> source = rampGrid(WIDTH, HEIGHT);
+    
+    for (Dither::Mode mode : {Dither::Mode::Ordered, Dither::Mode::FloydSteinberg, Dither::Mode::Atkinson})
+    {
+        std::vector<unsigned char> serial = source;
+        Dither::apply(mode, *table, serial.data(), WIDTH, HEIGHT, 1);
+        XCTAssertFalse(serial == source);
+        
+        for (size_t threads : {2, 3, 8})
+        {
+            for (int run = 0; run < 4; run++)
+            {
+                std::vector<unsigned char> threaded = source;
+                Dither::apply(mode, *table, threaded.data(), WIDTH, HEIGHT, threads);
+                XCTAssertTrue(threaded == serial, @"mode %d, %zu threads", (int)mode, threads);
+            }
+        }
+        
+        // fewer rows than threads
+        std::vector<unsigned char> shortSerial(source.begin(), source.begin() + WIDTH * 3 * 3);
+        std::vector<unsigned char> shortThreaded = shortSerial;
+        Dither::apply(mode, *table, shortSerial.data(), WIDTH, 3, 1);
+        Dither::apply(mode, *table, shortThreaded.data(), WIDTH, 3, 8);
+        XCTAssertTrue(shortThreaded == shortSerial, @"mode %d, 3 rows", (int)mode);
+    }
+}
+
+@end
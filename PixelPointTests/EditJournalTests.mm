@@ -0,0 +1,199 @@
+//
+//  EditJournalTests.mm
+//  PixelPointTests
+//
+//  Created by Kelsey Steeves on 2026-10-19.
+//  Copyright © 2026 Kelsey Steeves. All rights reserved.
+//
+
+#import <XCTest/XCTest.h>
+
+#include "Scene.h"
+
+#include <cstdlib>
+#include <vector>
+
+static const size_t WIDTH = 67;
+static const size_t HEIGHT = 45;
+
+// a few colors, so fills and recolors find areas to work on
+static Image patchyImage(size_t width, size_t height)
+{
+    unsigned char *data = (unsigned char *)malloc(width * height * 3);
+    for (size_t i = 0; i < width * height; i++)
+    {
+        const unsigned char value = rand() % 3 * 80;
+        data[i * 3] = value;
+        data[i * 3 + 1] = value;
+        data[i * 3 + 2] = 255 - value;
+    }
+    return Image(std::unique_ptr<unsigned char, decltype(&std::free)>(data, &std::free), width, height, 3);
+}
+
+static void randomEdit(Scene &scene)
+{
+    const Color color(rand() % 3 * 80, rand() % 3 * 80, 255 - rand() % 3 * 80);
+    switch (rand() % 5)
+    {
+        case 0:
+            scene.floodFill(rand() % (WIDTH * HEIGHT), color);
+            break;
+        case 1:
+            scene.fillRect(rand() % WIDTH, rand() % HEIGHT, rand() % 20, rand() % 20, color);
+            break;
+        case 2:
+            scene.drawLine(rand() % WIDTH, rand() % HEIGHT, rand() % WIDTH, rand() % HEIGHT, color);
+            break;
+        case 3:
+            scene.recolor(scene.colorAt(rand() % (WIDTH * HEIGHT)), color);
+            break;
+        default:
+            for (int i = 0; i < 5; i++)
+            {
+                scene.editCell(rand() % (WIDTH * HEIGHT), color);
+            }
+            break;
+    }
+}
+
+@interface EditJournalTests : XCTestCase
+
+@end
+
+@implementation EditJournalTests
+
+// random edits, undos and redos against a full snapshot of the grid after every committed step
+- (void)testHistoryMatchesSnapshots
+{
+    srand(44);
+    Scene scene;
+    scene.load(patchyImage(WIDTH, HEIGHT));
+    scene.enableJournal({(size_t)1 << 30, 0.0});
+    
+    std::vector<std::vector<unsigned char>> snapshots(1, scene.colors);
+    size_t position = 0;
+    double time = 0.0;
+    for (int step = 0; step < 400; step++)
+    {
+        const int action = rand() % 10;
+        if (action < 6)
+        {
+            const int operations = 1 + rand() % 3;
+            for (int i = 0; i < operations; i++)
+            {
+                randomEdit(scene);
+            }
+            scene.journal->commit(scene, time += 1.0);
+            
+            // an operation that changed nothing isn't a step
+            if (scene.colors != snapshots[position])
+            {
+                snapshots.resize(position + 1);
+                snapshots.push_back(scene.colors);
+                position++;
+            }
+        }
+        else if (action < 8)
+        {
+            const bool undone = scene.journal->undo(scene);
+            XCTAssertEqual(undone, position > 0, @"step %d", step);
+            position -= undone ? 1 : 0;
+        }
+        else
+        {
+            const bool redone = scene.journal->redo(scene);
+            XCTAssertEqual(redone, position + 1 < snapshots.size(), @"step %d", step);
+            position += redone ? 1 : 0;
+        }
+        
+        XCTAssertTrue(scene.colors == snapshots[position], @"step %d", step);
+        XCTAssertEqual(scene.journal->canUndo(), position > 0);
+        XCTAssertEqual(scene.journal->canRedo(), position + 1 < snapshots.size());
+    }
+    
+    // uncommitted edits are undone on their own first
+    const std::vector<unsigned char> before = scene.colors;
+    scene.editCell(5, Color(1, 2, 3));
+    XCTAssertTrue(scene.journal->undo(scene));
+    XCTAssertTrue(scene.colors == before);
+}
+
+// strokes within the interval of the one before undo as one step; a late one, or one after an
+// undo, stands alone
+- (void)testQuickStrokesUndoTogether
+{
+    srand(45);
+    Scene scene;
+    scene.load(patchyImage(WIDTH, HEIGHT));
+    scene.enableJournal({(size_t)1 << 30, 0.5});
+    const std::vector<unsigned char> base = scene.colors;
+    
+    scene.fillRect(0, 0, 5, 5, Color(7, 7, 7));
+    scene.journal->commit(scene, 10.0);
+    scene.fillRect(10, 10, 5, 5, Color(8, 8, 8));
+    scene.journal->commit(scene, 10.2);
+    scene.editCell(3, Color(9, 9, 9));
+    scene.journal->commit(scene, 10.5);
+    const std::vector<unsigned char> merged = scene.colors;
+    
+    scene.fillRect(20, 20, 5, 5, Color(6, 6, 6));
+    scene.journal->commit(scene, 12.5);
+    XCTAssertEqual(scene.journal->entryCount(), (size_t)2);
+    
+    XCTAssertTrue(scene.journal->undo(scene));
+    XCTAssertTrue(scene.colors == merged);
+    XCTAssertTrue(scene.journal->undo(scene));
+    XCTAssertTrue(scene.colors == base);
+    XCTAssertFalse(scene.journal->undo(scene));
+    
+    XCTAssertTrue(scene.journal->redo(scene));
+    XCTAssertTrue(scene.colors == merged);
+    
+    // a stroke right after an undo or redo starts its own step
+    scene.fillRect(30, 30, 3, 3, Color(5, 5, 5));
+    scene.journal->commit(scene, 12.6);
+    XCTAssertTrue(scene.journal->undo(scene));
+    XCTAssertTrue(scene.colors == merged);
+}
+
+// the cap covers the committed copy of the grid as well as the entries. the oldest entries go
+// first, the newest always stays, and what is left still undoes to the right colors
+- (void)testOldestEntriesAreDropped
+{
+    srand(46);
+    Scene scene;
+    scene.load(patchyImage(WIDTH, HEIGHT));
+    const size_t gridBytes = scene.colors.size();
+    scene.enableJournal({gridBytes + 4096, 0.0});
+    XCTAssertEqual(scene.journal->bytes(), gridBytes);
+    
+    std::vector<std::vector<unsigned char>> snapshots(1, scene.colors);
+    for (int step = 0; step < 200; step++)
+    {
+        scene.fillRect(rand() % WIDTH, rand() % HEIGHT, 1 + rand() % 12, 1 + rand() % 12, Color(rand() & 0xff, rand() & 0xff, rand() & 0xff));
+        scene.journal->commit(scene, step);
+        snapshots.push_back(scene.colors);
+        
+        XCTAssertTrue(scene.journal->bytes() <= scene.journal->limits.maxBytes || scene.journal->entryCount() == 1);
+    }
+    
+    const size_t kept = scene.journal->entryCount();
+    XCTAssertGreaterThan(kept, (size_t)1);
+    XCTAssertLessThan(kept, (size_t)200);
+    
+    for (size_t i = 0; i < kept; i++)
+    {
+        XCTAssertTrue(scene.journal->undo(scene));
+        XCTAssertTrue(scene.colors == snapshots[snapshots.size() - 2 - i]);
+    }
+    XCTAssertFalse(scene.journal->undo(scene));
+    
+    // a cap smaller than the grid copy still keeps the newest entry
+    scene.journal->limits.maxBytes = 0;
+    scene.editCell(0, Color(1, 1, 1));
+    scene.journal->commit(scene, 1000.0);
+    XCTAssertEqual(scene.journal->entryCount(), (size_t)1);
+    XCTAssertTrue(scene.journal->undo(scene));
+}
+
+@end
@@ -0,0 +1,201 @@
+//
+//  EditOverlayTests.mm
+//  PixelPointTests
+//
+//  Created by Kelsey Steeves on 2026-10-19.
+//  Copyright © 2026 Kelsey Steeves. All rights reserved.
+//
+
+#import <XCTest/XCTest.h>
+
+#include "EditOverlay.h"
+
+#include <cstdlib>
+#include <map>
+#include <set>
+#include <utility>
+#include <vector>
+
+static const size_t WIDTH = 48;
+static const size_t HEIGHT = 40;
+
+// edits the plain way, by x and y
+typedef std::map<std::pair<size_t, size_t>, uint32_t> EditMap;
+
+static uint32_t packed(const unsigned char *rgb)
+{
+    return (uint32_t)rgb[0] << 16 | (uint32_t)rgb[1] << 8 | rgb[2];
+}
+
+// the ith of a run of colors that never repeat
+static uint32_t colorNumber(size_t i)
+{
+    return (uint32_t)(i * 2654435761u) & 0xffffff;
+}
+
+// sets one cell of the grid and records it, like Scene::editCell does
+static void edit(EditOverlay &overlay, std::vector<unsigned char> &grid, size_t width, size_t x, size_t y, uint32_t color)
+{
+    const size_t cell = y * width + x;
+    unsigned char *rgb = &grid[cell * 3];
+    rgb[0] = color >> 16;
+    rgb[1] = color >> 8;
+    rgb[2] = color;
+    overlay.record(grid.data(), width, grid.size() / 3 / width, cell, cell);
+}
+
+// compositing over a fresh grid of any size has to give the grid with just the edits that fall
+// in it written over it
+static bool matches(const EditOverlay &overlay, const EditMap &edits, size_t width, size_t height)
+{
+    std::vector<unsigned char> base(width * height * 3);
+    for (unsigned char &value : base)
+    {
+        value = rand() & 0xff;
+    }
+    
+    std::vector<unsigned char> expected = base;
+    for (const std::pair<const std::pair<size_t, size_t>, uint32_t> &edit : edits)
+    {
+        if (edit.first.first < width && edit.first.second < height)
+        {
+            unsigned char *rgb = &expected[(edit.first.second * width + edit.first.first) * 3];
+            rgb[0] = edit.second >> 16;
+            rgb[1] = edit.second >> 8;
+            rgb[2] = edit.second;
+        }
+    }
+    
+    overlay.composite(base.data(), width, height);
+    return base == expected;
+}
+
+@interface EditOverlayTests : XCTestCase
+
+@end
+
+@implementation EditOverlayTests
+
+// past a sixteenth of the grid the overlay goes dense, and stays so while its edits fit 256
+// colors. the 257th color sends it back to sparse for good, without losing an edit
+- (void)testSwitchesBetweenSparseAndDense
+{
+    srand(45);
+    EditOverlay overlay;
+    EditMap edits;
+    std::vector<unsigned char> grid(WIDTH * HEIGHT * 3);
+    
+    // a few colors, until just past the switch
+    const size_t threshold = WIDTH * HEIGHT / 16;
+    while (edits.size() <= threshold)
+    {
+        XCTAssertFalse(overlay.isDense());
+        const size_t x = rand() % WIDTH, y = rand() % HEIGHT;
+        const uint32_t color = colorNumber(rand() % 20);
+        edit(overlay, grid, WIDTH, x, y, color);
+        edits[std::make_pair(x, y)] = color;
+        XCTAssertEqual(overlay.size(), edits.size());
+    }
+    XCTAssertTrue(overlay.isDense());
+    XCTAssertTrue(matches(overlay, edits, WIDTH, HEIGHT));
+    
+    // a dense overlay still lands by x and y on other grids
+    XCTAssertTrue(matches(overlay, edits, WIDTH - 7, HEIGHT + 5));
+    
+    // the palette grows by every new color, even ones whose cells are later painted over
+    std::set<uint32_t> colors;
+    for (const std::pair<const std::pair<size_t, size_t>, uint32_t> &edit : edits)
+    {
+        colors.insert(edit.second);
+    }
+    for (size_t next = 20; colors.size() < 256; next++)
+    {
+        const size_t x = rand() % WIDTH, y = rand() % HEIGHT;
+        edit(overlay, grid, WIDTH, x, y, colorNumber(next));
+        edits[std::make_pair(x, y)] = colorNumber(next);
+        colors.insert(colorNumber(next));
+        XCTAssertTrue(overlay.isDense());
+        XCTAssertEqual(overlay.size(), edits.size());
+    }
+    XCTAssertTrue(matches(overlay, edits, WIDTH, HEIGHT));
+    
+    // reusing a color is fine, a new one is the 257th
+    edit(overlay, grid, WIDTH, 0, 0, *colors.begin());
+    edits[std::make_pair(0, 0)] = *colors.begin();
+    XCTAssertTrue(overlay.isDense());
+    
+    edit(overlay, grid, WIDTH, 1, 0, colorNumber(1000));
+    edits[std::make_pair(1, 0)] = colorNumber(1000);
+    XCTAssertFalse(overlay.isDense());
+    XCTAssertEqual(overlay.size(), edits.size());
+    XCTAssertTrue(matches(overlay, edits, WIDTH, HEIGHT));
+    
+    // and it stays sparse, however much more is edited
+    for (int i = 0; i < 400; i++)
+    {
+        const size_t x = rand() % WIDTH, y = rand() % HEIGHT;
+        edit(overlay, grid, WIDTH, x, y, colorNumber(rand() % 4));
+        edits[std::make_pair(x, y)] = packed(&grid[(y * WIDTH + x) * 3]);
+    }
+    XCTAssertFalse(overlay.isDense());
+    XCTAssertEqual(overlay.size(), edits.size());
+    XCTAssertTrue(matches(overlay, edits, WIDTH, HEIGHT));
+    
+    // until cleared
+    overlay.clear();
+    XCTAssertTrue(overlay.empty());
+    XCTAssertFalse(overlay.isDense());
+    XCTAssertTrue(matches(overlay, EditMap(), WIDTH, HEIGHT));
+}
+
+// an edit made after a reload to a smaller grid turns a dense overlay back into edits by x and
+// y. it goes dense again over the new grid straight away, since it already covers more than a
+// sixteenth of it, and the edits that fell off the grid go with the switch
+- (void)testReloadToSmallerGrid
+{
+    srand(46);
+    EditOverlay overlay;
+    EditMap edits;
+    std::vector<unsigned char> grid(WIDTH * HEIGHT * 3);
+    for (int i = 0; i < 300; i++)
+    {
+        const size_t x = rand() % WIDTH, y = rand() % HEIGHT;
+        edit(overlay, grid, WIDTH, x, y, colorNumber(rand() % 8));
+        edits[std::make_pair(x, y)] = packed(&grid[(y * WIDTH + x) * 3]);
+    }
+    XCTAssertTrue(overlay.isDense());
+    XCTAssertTrue(matches(overlay, edits, WIDTH, HEIGHT));
+    
+    const size_t smallWidth = 30, smallHeight = 25;
+    std::vector<unsigned char> small(smallWidth * smallHeight * 3);
+    
+    // the reload lays the edits over the new image
+    overlay.composite(small.data(), smallWidth, smallHeight);
+    XCTAssertTrue(matches(overlay, edits, smallWidth, smallHeight));
+    
+    edit(overlay, small, smallWidth, smallWidth - 1, smallHeight - 1, colorNumber(2));
+    edits[std::make_pair(smallWidth - 1, smallHeight - 1)] = colorNumber(2);
+    for (EditMap::iterator edit = edits.begin(); edit != edits.end();)
+    {
+        edit = edit->first.first < smallWidth && edit->first.second < smallHeight ? std::next(edit) : edits.erase(edit);
+    }
+    XCTAssertTrue(overlay.isDense());
+    XCTAssertEqual(overlay.size(), edits.size());
+    XCTAssertTrue(matches(overlay, edits, smallWidth, smallHeight));
+    
+    // and laid over the larger grid again, only the kept edits show
+    XCTAssertTrue(matches(overlay, edits, WIDTH, HEIGHT));
+    
+    // more edits over the small grid carry on densely
+    for (int i = 0; i < 200; i++)
+    {
+        const size_t x = rand() % smallWidth, y = rand() % smallHeight;
+        edit(overlay, small, smallWidth, x, y, colorNumber(rand() % 8));
+        edits[std::make_pair(x, y)] = packed(&small[(y * smallWidth + x) * 3]);
+    }
+    XCTAssertTrue(overlay.isDense());
+    XCTAssertEqual(overlay.size(), edits.size());
+    XCTAssertTrue(matches(overlay, edits, smallWidth, smallHeight));
+}
+
+@end
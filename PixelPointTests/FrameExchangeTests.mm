@@ -0,0 +1,89 @@
+//
+//  FrameExchangeTests.mm
+//  PixelPointTests
+//
+//  Created by Kelsey Steeves on 2026-10-19.
+//  Copyright © 2026 Kelsey Steeves. All rights reserved.
+//
+
+#import <XCTest/XCTest.h>
+
+#include "FrameExchange.h"
+
+#include <thread>
+#include <vector>
+
+static const size_t FRAME_COUNT = 100000;
+
+// every value of a frame is its sequence number, and frames vary in length, so a frame read
+// while it was being written shows up as a mix of numbers or a length that doesn't match
+struct NumberedFrame
+{
+    size_t sequence;
+    std::vector<size_t> values;
+};
+
+static size_t lengthFor(size_t sequence)
+{
+    return 64 + sequence % 61;
+}
+
+@interface FrameExchangeTests : XCTestCase
+
+@end
+
+@implementation FrameExchangeTests
+
+// one thread publishes as fast as it can while another takes whatever is newest. every frame
+// taken is whole and newer than the one before, the last one published is always taken, and
+// every other frame was either taken or counted as dropped
+- (void)testFramesArriveWholeAndInOrder
+{
+    FrameExchange<NumberedFrame> exchange;
+    FrameExchange<NumberedFrame> *shared = &exchange;
+    
+    std::thread producer([shared]
+    {
+        for (size_t sequence = 1; sequence <= FRAME_COUNT; sequence++)
+        {
+            NumberedFrame &frame = shared->backFrame();
+            frame.sequence = sequence;
+            frame.values.assign(lengthFor(sequence), sequence);
+            shared->publish();
+        }
+    });
+    
+    size_t last = 0, taken = 0, torn = 0, backwards = 0;
+    while (last < FRAME_COUNT)
+    {
+        const NumberedFrame *frame = exchange.takeLatest();
+        if (!frame)
+        {
+            std::this_thread::yield();
+            continue;
+        }
+        
+        bool whole = frame->values.size() == lengthFor(frame->sequence);
+        for (size_t value : frame->values)
+        {
+            whole = whole && value == frame->sequence;
+        }
+        torn += !whole;
+        backwards += frame->sequence <= last;
+        last = frame->sequence;
+        taken++;
+    }
+    producer.join();
+    
+    XCTAssertEqual(torn, (size_t)0);
+    XCTAssertEqual(backwards, (size_t)0);
+    XCTAssertEqual(last, FRAME_COUNT);
+    XCTAssertFalse(exchange.hasNewFrame());
+    XCTAssertTrue(exchange.takeLatest() == nullptr);
+    
+    XCTAssertEqual(exchange.published.load(), FRAME_COUNT);
+    XCTAssertEqual(exchange.taken.load(), taken);
+    XCTAssertEqual(exchange.taken.load() + exchange.dropped.load(), FRAME_COUNT);
+}
+
+@end
@@ -0,0 +1,42 @@
+//
+//  GLTestContext.h
+//  PixelPointTests
+//
+//  Created by Kelsey Steeves on 2026-10-19.
+//  Copyright © 2026 Kelsey Steeves. All rights reserved.
+//
+
+#ifndef GLTestContext_h
+#define GLTestContext_h
+
+#import <OpenGL/OpenGL.h>
+#include <OpenGL/gl3.h>
+
+#include <vector>
+
+// a GL 3.2 core context with nothing on screen, drawing into an RGBA framebuffer of the given
+// size. it is current from construction until it is destroyed
+class GLTestContext
+{
+public:
+    GLTestContext(int width, int height);
+    ~GLTestContext();
+    
+    GLTestContext(const GLTestContext &) = delete;
+    GLTestContext &operator=(const GLTestContext &) = delete;
+    
+    bool valid() const;
+    
+    // the framebuffer, bottom row first
+    std::vector<unsigned char> readPixels() const;
+    
+    const int width;
+    const int height;
+    
+private:
+    CGLContextObj context;
+    GLuint framebuffer;
+    GLuint renderbuffer;
+};
+
+#endif /* GLTestContext_h */
@@ -0,0 +1,70 @@
+//
+//  GLTestContext.mm
+//  PixelPointTests
+//
+//  Created by Kelsey Steeves on 2026-10-19.
+//  Copyright © 2026 Kelsey Steeves. All rights reserved.
+//
+
+#include "GLTestContext.h"
+
+GLTestContext::GLTestContext(int width, int height)
+: width(width), height(height), context(nullptr), framebuffer(0), renderbuffer(0)
+{
+    // offline renderers are fine, nothing is shown
+    const CGLPixelFormatAttribute attributes[] =
+    {
+        kCGLPFAOpenGLProfile, (CGLPixelFormatAttribute)kCGLOGLPVersion_3_2_Core,
+        kCGLPFAColorSize, (CGLPixelFormatAttribute)24,
+        kCGLPFAAllowOfflineRenderers,
+        (CGLPixelFormatAttribute)0
+    };
+    
+    CGLPixelFormatObj pixelFormat = nullptr;
+    GLint formats = 0;
+    if (CGLChoosePixelFormat(attributes, &pixelFormat, &formats) != kCGLNoError || !pixelFormat)
+    {
+        return;
+    }
+    CGLCreateContext(pixelFormat, nullptr, &context);
+    CGLDestroyPixelFormat(pixelFormat);
+    if (!context)
+    {
+        return;
+    }
+    CGLSetCurrentContext(context);
+    
+    glGenFramebuffers(1, &framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    glGenRenderbuffers(1, &renderbuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, renderbuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, renderbuffer);
+    glViewport(0, 0, width, height);
+}
+
+GLTestContext::~GLTestContext()
+{
+    if (!context)
+    {
+        return;
+    }
+    
+    glDeleteRenderbuffers(1, &renderbuffer);
+    glDeleteFramebuffers(1, &framebuffer);
+    CGLSetCurrentContext(nullptr);
+    CGLDestroyContext(context);
+}
+
+bool GLTestContext::valid() const
+{
+    return context && glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+}
+
+std::vector<unsigned char> GLTestContext::readPixels() const
+{
+    std::vector<unsigned char> pixels((size_t)width * height * 4);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+    return pixels;
+}
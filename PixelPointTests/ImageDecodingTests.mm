@@ -0,0 +1,400 @@
+//
+//  ImageDecodingTests.mm
+//  PixelPointTests
+//
+//  Created by Kelsey Steeves on 2026-10-19.
+//  Copyright © 2026 Kelsey Steeves. All rights reserved.
+//
+
+#import <XCTest/XCTest.h>
+
+#include "Image.h"
+#include "stb_image_aug.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+static void appendBigEndian(std::vector<unsigned char> &out, uint32_t value)
+{
+    out.push_back(value >> 24);
+    out.push_back(value >> 16);
+    out.push_back(value >> 8);
+    out.push_back(value);
+}
+
+static uint32_t crc32(const unsigned char *data, size_t length)
+{
+    static uint32_t table[256];
+    if (!table[1])
+    {
+        for (uint32_t i = 0; i < 256; i++)
+        {
+            uint32_t c = i;
+            for (int k = 0; k < 8; k++)
+            {
+                c = c & 1 ? 0xedb88320u ^ (c >> 1) : c >> 1;
+            }
+            table[i] = c;
+        }
+    }
+    
+    uint32_t crc = 0xffffffffu;
+    for (size_t i = 0; i < length; i++)
+    {
+        crc = table[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+    }
+    return crc ^ 0xffffffffu;
+}
+
+static void appendChunk(std::vector<unsigned char> &png, const char *type, const std::vector<unsigned char> &data)
+{
+    appendBigEndian(png, (uint32_t)data.size());
+    std::vector<unsigned char> body(type, type + 4);
+    body.insert(body.end(), data.begin(), data.end());
+    png.insert(png.end(), body.begin(), body.end());
+    appendBigEndian(png, crc32(body.data(), body.size()));
+}
+
+static int paeth(int a, int b, int c)
+{
+    const int p = a + b - c, pa = abs(p - a), pb = abs(p - b), pc = abs(p - c);
+    return pa <= pb && pa <= pc ? a : (pb <= pc ? b : c);
+}
+
+// an 8 bit PNG of 1 to 4 channel pixels, row y filtered with filters[y % filters.size()]. the
+// zlib stream is all stored blocks, so the decoder sees exactly the filters asked for
+static std::vector<unsigned char> encodePNG(const std::vector<unsigned char> &pixels, int width, int height, int channels, const std::vector<int> &filters)
+{
+    static const unsigned char COLOR_TYPES[] = {0, 0, 4, 2, 6};
+    const size_t stride = (size_t)width * channels;
+    
+    std::vector<unsigned char> raw;
+    for (int y = 0; y < height; y++)
+    {
+        const int filter = filters[y % filters.size()];
+        const unsigned char *row = &pixels[y * stride], *prior = y > 0 ? row - stride : nullptr;
+        raw.push_back(filter);
+        for (size_t i = 0; i < stride; i++)
+        {
+            const int left = i >= (size_t)channels ? row[i - channels] : 0;
+            const int up = prior ? prior[i] : 0;
+            const int upLeft = prior && i >= (size_t)channels ? prior[i - channels] : 0;
+            const int predictions[] = {0, left, up, (left + up) >> 1, paeth(left, up, upLeft)};
+            raw.push_back((unsigned char)(row[i] - predictions[filter]));
+        }
+    }
+    
+    std::vector<unsigned char> zlib = {0x78, 0x01};
+    for (size_t offset = 0; offset < raw.size(); offset += 0xffff)
+    {
+        const size_t length = std::min(raw.size() - offset, (size_t)0xffff);
+        zlib.push_back(offset + length == raw.size());
+        zlib.push_back(length & 0xff);
+        zlib.push_back(length >> 8);
+        zlib.push_back(~length & 0xff);
+        zlib.push_back((~length >> 8) & 0xff);
+        zlib.insert(zlib.end(), raw.begin() + offset, raw.begin() + offset + length);
+    }
+    uint32_t a = 1, b = 0;
+    for (unsigned char byte : raw)
+    {
+        a = (a + byte) % 65521;
+        b = (b + a) % 65521;
+    }
+    appendBigEndian(zlib, b << 16 | a);
+    
+    std::vector<unsigned char> header;
+    appendBigEndian(header, width);
+    appendBigEndian(header, height);
+    header.insert(header.end(), {8, COLOR_TYPES[channels], 0, 0, 0});
+    
+    std::vector<unsigned char> png = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n'};
+    appendChunk(png, "IHDR", header);
+    appendChunk(png, "IDAT", zlib);
+    appendChunk(png, "IEND", {});
+    return png;
+}
+
+// a bottom up 24 bit BMP. planes should be 1; anything else makes a file stb refuses
+static std::vector<unsigned char> encodeBMP(const std::vector<unsigned char> &rgb, int width, int height, int planes)
+{
+    const int stride = (width * 3 + 3) & ~3;
+    std::vector<unsigned char> bmp = {'B', 'M'};
+    auto append = [&bmp](uint32_t value, int bytes)
+    {
+        for (int i = 0; i < bytes; i++)
+        {
+            bmp.push_back(value >> (8 * i));
+        }
+    };
+    append(54 + stride * height, 4);
+    append(0, 4);
+    append(54, 4);
+    append(40, 4);
+    append(width, 4);
+    append(height, 4);
+    append(planes, 2);
+    append(24, 2);
+    append(0, 4);
+    append(stride * height, 4);
+    append(2835, 4);
+    append(2835, 4);
+    append(0, 4);
+    append(0, 4);
+    for (int y = height - 1; y >= 0; y--)
+    {
+        for (int x = 0; x < width; x++)
+        {
+            const unsigned char *pixel = &rgb[(y * width + x) * 3];
+            bmp.insert(bmp.end(), {pixel[2], pixel[1], pixel[0]});
+        }
+        bmp.resize(bmp.size() + stride - width * 3);
+    }
+    return bmp;
+}
+
+// decodes with the given settings, returning an empty vector on failure
+static std::vector<unsigned char> decode(stbi_context &ctx, const std::vector<unsigned char> &file, int reqComp, int *width, int *height)
+{
+    int channels;
+    stbi_uc *data = stbi_load_from_memory_ctx(&ctx, file.data(), (int)file.size(), width, height, &channels, reqComp);
+    if (!data)
+    {
+        return std::vector<unsigned char>();
+    }
+    
+    std::vector<unsigned char> pixels(data, data + (size_t)*width * *height * (reqComp ? reqComp : channels));
+    stbi_image_free(data);
+    return pixels;
+}
+
+@interface ImageDecodingTests : XCTestCase
+
+@end
+
+static std::vector<unsigned char> fixture(NSString *name)
+{
+    NSData *data = [NSData dataWithContentsOfURL:[[NSBundle bundleForClass:[ImageDecodingTests class]] URLForResource:name withExtension:nil]];
+    return std::vector<unsigned char>((const unsigned char *)data.bytes, (const unsigned char *)data.bytes + data.length);
+}
+
+static std::string fixturePath(NSString *name)
+{
+    return [[[NSBundle bundleForClass:[ImageDecodingTests class]] pathForResource:name ofType:nil] UTF8String];
+}
+
+@implementation ImageDecodingTests
+
+// the SSE2 / NEON unfilter has to give the same bytes as the scalar one for every filter and
+// channel count. it only runs when the output keeps the file's channels, so expanding to 4
+// checks the scalar path alone against the source too. on a CPU without either both decodes
+// are scalar and this still checks the filters
+- (void)testPNGUnfilterMatchesScalar
+{
+    const std::vector<std::vector<int>> filterSets = {{0}, {1}, {2}, {3}, {4}, {0, 1, 2, 3, 4}, {4, 3, 2, 1, 0, 3, 4}};
+    const int widths[] = {1, 2, 3, 5, 8, 16, 17, 33};
+    const int height = 9;
+    
+    srand(26);
+    for (int channels = 1; channels <= 4; channels++)
+    {
+        for (int width : widths)
+        {
+            std::vector<unsigned char> pixels((size_t)width * height * channels);
+            for (unsigned char &component : pixels)
+            {
+                component = rand() & 0xff;
+            }
+            
+            for (size_t set = 0; set < filterSets.size(); set++)
+            {
+                const std::vector<unsigned char> file = encodePNG(pixels, width, height, channels, filterSets[set]);
+                for (int reqComp : {0, 4})
+                {
+                    stbi_context simd, scalar;
+                    stbi_context_init(&simd);
+                    stbi_context_init(&scalar);
+                    simd.png_simd = 1;
+                    scalar.png_simd = 0;
+                    
+                    int simdWidth = 0, simdHeight = 0, scalarWidth = 0, scalarHeight = 0;
+                    const std::vector<unsigned char> simdPixels = decode(simd, file, reqComp, &simdWidth, &simdHeight);
+                    const std::vector<unsigned char> scalarPixels = decode(scalar, file, reqComp, &scalarWidth, &scalarHeight);
+                    
+                    XCTAssertFalse(simdPixels.empty(), @"channels %d width %d filters %zu: %s", channels, width, set, simd.failure_reason);
+                    XCTAssertFalse(scalarPixels.empty(), @"channels %d width %d filters %zu: %s", channels, width, set, scalar.failure_reason);
+                    XCTAssertEqual(simdWidth, width);
+                    XCTAssertEqual(simdHeight, height);
+                    XCTAssertTrue(simdPixels == scalarPixels, @"channels %d width %d filters %zu req %d", channels, width, set, reqComp);
+                    if (reqComp == 0)
+                    {
+                        XCTAssertTrue(simdPixels == pixels, @"channels %d width %d filters %zu", channels, width, set);
+                    }
+                }
+            }
+        }
+    }
+}
+
+// loads on many threads at once, some of them failing, each have to come out the same as they
+// do alone, failure reasons included. run it with the Thread Sanitizer on (the PixelPoint
+// Thread Sanitizer scheme) to catch shared state that happens not to corrupt anything here
+- (void)testConcurrentLoadsAreIndependent
+{
+    struct Input
+    {
+        std::vector<unsigned char> file;
+        int reqComp;
+        std::vector<unsigned char> pixels;
+        std::string failure;
+    };
+    
+    srand(27);
+    std::vector<unsigned char> rgb(37 * 23 * 3);
+    for (unsigned char &component : rgb)
+    {
+        component = rand() & 0xff;
+    }
+    
+    std::vector<Input> inputs =
+    {
+        {fixture(@"dynamic_huffman.png"), 0},
+        {fixture(@"fixed_huffman.png"), 3},
+        {encodePNG(rgb, 37, 23, 3, {0, 1, 2, 3, 4}), 0},
+        {encodePNG(rgb, 37, 23, 3, {4}), 1},
+        {encodeBMP(rgb, 37, 23, 1), 4},
+        {encodeBMP(rgb, 37, 23, 2), 0},
+        {std::vector<unsigned char>(64, 0x5a), 0}
+    };
+    
+    std::vector<unsigned char> truncated = inputs[0].file;
+    truncated.resize(truncated.size() / 2);
+    inputs.push_back({truncated, 0});
+    
+    for (Input &input : inputs)
+    {
+        stbi_context ctx;
+        stbi_context_init(&ctx);
+        int width, height;
+        input.pixels = decode(ctx, input.file, input.reqComp, &width, &height);
+        input.failure = ctx.failure_reason ? ctx.failure_reason : "";
+    }
+    XCTAssertFalse(inputs[0].pixels.empty(), @"%s", inputs[0].failure.c_str());
+    XCTAssertFalse(inputs[4].pixels.empty(), @"%s", inputs[4].failure.c_str());
+    XCTAssertTrue(inputs[5].failure == "bad BMP");
+    XCTAssertTrue(inputs[6].pixels.empty());
+    XCTAssertTrue(inputs[7].pixels.empty());
+    
+    const int threadCount = 16, rounds = 40;
+    std::atomic<int> mismatches(0), wrongReasons(0);
+    std::vector<std::thread> threads;
+    for (int i = 0; i < threadCount; i++)
+    {
+        threads.emplace_back([&, i]
+        {
+            for (int round = 0; round < rounds; round++)
+            {
+                const Input &input = inputs[(i + round) % inputs.size()];
+                stbi_context ctx;
+                stbi_context_init(&ctx);
+                ctx.png_simd = round & 1;
+                
+                int width, height;
+                if (decode(ctx, input.file, input.reqComp, &width, &height) != input.pixels)
+                {
+                    mismatches++;
+                }
+                
+                // and the reason stays with this thread's last load
+                const char *reason = stbi_failure_reason();
+                if (input.pixels.empty() && (!ctx.failure_reason || input.failure != ctx.failure_reason || !reason || input.failure != reason))
+                {
+                    wrongReasons++;
+                }
+            }
+        });
+    }
+    for (std::thread &thread : threads)
+    {
+        thread.join();
+    }
+    
+    XCTAssertEqual(mismatches.load(), 0);
+    XCTAssertEqual(wrongReasons.load(), 0);
+}
+
+// the fixture is over the size restart intervals are decoded in parallel from, with an
+// interval every 7 MCUs so the bands split unevenly. a thread count of 1 decodes serially
+- (void)testParallelJPEGMatchesSerial
+{
+    const std::vector<unsigned char> file = fixture(@"restart_intervals.jpg");
+    
+    stbi_context serial;
+    stbi_context_init(&serial);
+    serial.jpeg_threads = 1;
+    int width = 0, height = 0;
+    const std::vector<unsigned char> expected = decode(serial, file, 0, &width, &height);
+    XCTAssertFalse(expected.empty(), @"%s", serial.failure_reason);
+    XCTAssertEqual(width, 640);
+    XCTAssertEqual(height, 512);
+    
+    for (int threads : {2, 3, 4, 7})
+    {
+        stbi_context parallel;
+        stbi_context_init(&parallel);
+        parallel.jpeg_threads = threads;
+        int parallelWidth = 0, parallelHeight = 0;
+        const std::vector<unsigned char> pixels = decode(parallel, file, 0, &parallelWidth, &parallelHeight);
+        XCTAssertFalse(pixels.empty(), @"%d threads: %s", threads, parallel.failure_reason);
+        XCTAssertTrue(pixels == expected, @"%d threads", threads);
+    }
+}
+
+// color JPEGs are converted from the planes pixel by pixel instead of decoding to RGB. stb
+// upsamples chroma smoothly where the planes pair each pixel with the sample it sits in, so the
+// two can be a few levels apart at chroma edges, whichever way the pixels are averaged
+- (void)checkJPEGPlanesMatchRGB:(Image::Averaging)averaging
+{
+    const std::vector<unsigned char> file = fixture(@"restart_intervals.jpg");
+    stbi_context context;
+    stbi_context_init(&context);
+    int width = 0, height = 0;
+    std::vector<unsigned char> rgb = decode(context, file, 3, &width, &height);
+    XCTAssertFalse(rgb.empty(), @"%s", context.failure_reason);
+    
+    const Image expected = Image::scaledFromSource(rgb.data(), width, height, 3, width * 3, averaging);
+    const Image scaled = Image::loadScaledImage(fixturePath(@"restart_intervals.jpg").c_str(), false, averaging);
+    XCTAssertEqual(scaled.width, expected.width);
+    XCTAssertEqual(scaled.height, expected.height);
+    XCTAssertEqual(scaled.channels, 3);
+    
+    const size_t count = expected.width * expected.height * 3;
+    size_t close = 0;
+    int largest = 0;
+    for (size_t i = 0; i < count; i++)
+    {
+        const int difference = std::abs(scaled.data.get()[i] - expected.data.get()[i]);
+        largest = std::max(largest, difference);
+        close += difference <= 1;
+    }
+    XCTAssertLessThanOrEqual(largest, 3);
+    XCTAssertGreaterThan(close, count * 9 / 10);
+}
+
+- (void)testJPEGPlanesMatchRGB
+{
+    [self checkJPEGPlanesMatchRGB:Image::Averaging::RootMeanSquare];
+}
+
+- (void)testLinearJPEGPlanesMatchRGB
+{
+    [self checkJPEGPlanesMatchRGB:Image::Averaging::Linear];
+}
+
+@end
@@ -0,0 +1,154 @@
+//
+//  PaletteTableTests.mm
+//  PixelPointTests
+//
+//  Created by Kelsey Steeves on 2026-10-19.
+//  Copyright © 2026 Kelsey Steeves. All rights reserved.
+//
+
+#import <XCTest/XCTest.h>
+
+#include "PaletteTable.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <unordered_map>
+#include <vector>
+
+static Palette randomPalette(size_t count, size_t duplicates)
+{
+    std::vector<Color> colors;
+    for (size_t i = 0; i < count - duplicates; i++)
+    {
+        colors.push_back(Color(rand() & 0xff, rand() & 0xff, rand() & 0xff));
+    }
+    
+    // copies of earlier colors, spread through the palette so the first of them has to win
+    for (size_t i = 0; i < duplicates; i++)
+    {
+        const Color copy = colors[rand() % colors.size()];
+        colors.insert(colors.begin() + rand() % (colors.size() + 1), copy);
+    }
+    return Palette(colors);
+}
+
+// every component value either side of a box edge, plus a few inside
+static std::vector<int> componentSamples()
+{
+    std::vector<int> values;
+    const int boxSize = 256 >> PaletteTable::BITS;
+    for (int edge = 0; edge < 256; edge += boxSize)
+    {
+        for (int value : {edge - 1, edge, edge + boxSize / 2})
+        {
+            if (value >= 0 && value < 256)
+            {
+                values.push_back(value);
+            }
+        }
+    }
+    values.push_back(255);
+    return values;
+}
+
+@interface PaletteTableTests : XCTestCase
+
+@end
+
+@implementation PaletteTableTests
+
+// the table has to pick the same color Palette::nearest does, the first of equally near ones
+// included, for 1, 16 and 256 color palettes with repeated colors. the sampled cube covers
+// both sides of every box edge, where a box stops being owned by one color
+- (void)testLookupsMatchPalette
+{
+    srand(48);
+    const std::vector<int> samples = componentSamples();
+    const Palette palettes[] = {randomPalette(1, 0), randomPalette(16, 3), randomPalette(256, 20), Palette(std::vector<Color>(8, Color(10, 200, 30)))};
+    
+    for (const Palette &palette : palettes)
+    {
+        const std::shared_ptr<const PaletteTable> table = PaletteTable::forPalette(palette);
+        XCTAssertTrue(table->palette() == palette);
+        
+        size_t mismatches = 0;
+        for (int red : samples)
+        {
+            for (int green : samples)
+            {
+                for (int blue : samples)
+                {
+                    const Color color(red, green, blue);
+                    mismatches += table->nearest(color) != palette.nearest(color);
+                }
+            }
+        }
+        
+        for (int i = 0; i < 200000; i++)
+        {
+            const Color color(rand() & 0xff, rand() & 0xff, rand() & 0xff);
+            mismatches += table->nearest(color) != palette.nearest(color);
+        }
+        XCTAssertEqual(mismatches, (size_t)0, @"%zu colors", palette.size());
+    }
+}
+
+// palettes are cached by hash, so two palettes whose hashes collide must still get their own
+// tables. FNV-1a is built from colors that only differ in the top half of the state after the
+// first, so the second color can cancel the difference out
+- (void)testCacheTellsCollidingPalettesApart
+{
+    const uint64_t offset = 14695981039346656037ull, prime = 1099511628211ull;
+    std::unordered_map<uint32_t, uint32_t> seen;
+    uint32_t first = 0, second = 0;
+    srand(49);
+    while (true)
+    {
+        const uint32_t word = (uint32_t)rand() << 16 ^ (uint32_t)rand();
+        const uint32_t top = (uint32_t)(((offset ^ word) * prime) >> 32);
+        auto match = seen.find(top);
+        if (match != seen.end() && match->second != word)
+        {
+            first = match->second;
+            second = word;
+            break;
+        }
+        seen[top] = word;
+    }
+    
+    const uint32_t difference = (uint32_t)(((offset ^ first) * prime) ^ ((offset ^ second) * prime));
+    const Color tail = Color(40, 90, 200);
+    const Palette a(std::vector<Color>{Color::fromWord(first), tail});
+    const Palette b(std::vector<Color>{Color::fromWord(second), Color::fromWord(tail.word() ^ difference)});
+    XCTAssertEqual(a.hash(), b.hash());
+    XCTAssertFalse(a == b);
+    
+    // both stay cached, and are asked for again in turn
+    for (int round = 0; round < 3; round++)
+    {
+        for (const Palette *palette : {&a, &b})
+        {
+            const std::shared_ptr<const PaletteTable> table = PaletteTable::forPalette(*palette);
+            XCTAssertTrue(table->palette() == *palette);
+            
+            srand(round);
+            for (int i = 0; i < 1000; i++)
+            {
+                const Color color(rand() & 0xff, rand() & 0xff, rand() & 0xff);
+                XCTAssertEqual(table->nearest(color), palette->nearest(color));
+            }
+        }
+    }
+    
+    // and a palette pushed out by four newer ones is built again, not mixed up with another
+    const std::shared_ptr<const PaletteTable> kept = PaletteTable::forPalette(a);
+    for (int i = 0; i < 4; i++)
+    {
+        PaletteTable::forPalette(randomPalette(4, 0));
+    }
+    const std::shared_ptr<const PaletteTable> rebuilt = PaletteTable::forPalette(a);
+    XCTAssertTrue(rebuilt != kept);
+    XCTAssertTrue(rebuilt->palette() == a);
+}
+
+@end
@@ -0,0 +1,257 @@
+//
+//  PaletteTests.mm
+//  PixelPointTests
+//
+//  Created by Kelsey Steeves on 2026-10-19.
+//  Copyright © 2026 Kelsey Steeves. All rights reserved.
+//
+
+#import <XCTest/XCTest.h>
+
+#include "Palette.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <vector>
+
+static Image makeImage(size_t width, size_t height, int channels)
+{
+    unsigned char *data = (unsigned char *)malloc(width * height * channels);
+    return Image(std::unique_ptr<unsigned char, decltype(&std::free)>(data, &std::free), width, height, channels);
+}
+
+// cells scattered a few steps around each of the centers
+static Image clusterImage(const std::vector<Color> &centers, size_t width, size_t height)
+{
+    Image image = makeImage(width, height, 3);
+    unsigned char *cell = image.data.get();
+    for (size_t i = 0; i < width * height; i++, cell += 3)
+    {
+        const Color &center = centers[rand() % centers.size()];
+        cell[0] = (unsigned char)std::min(255, std::max(0, center.red + rand() % 9 - 4));
+        cell[1] = (unsigned char)std::min(255, std::max(0, center.green + rand() % 9 - 4));
+        cell[2] = (unsigned char)std::min(255, std::max(0, center.blue + rand() % 9 - 4));
+    }
+    return image;
+}
+
+static Color cellColor(const unsigned char *cell, int channels)
+{
+    return channels < 3 ? Color(cell[0], cell[0], cell[0]) : Color(cell[0], cell[1], cell[2]);
+}
+
+// the first of the nearest colors, the long way
+static size_t nearestIndex(const std::vector<Color> &colors, const Color &color)
+{
+    size_t best = 0;
+    int bestDistance = INT32_MAX;
+    for (size_t i = 0; i < colors.size(); i++)
+    {
+        const int dr = colors[i].red - color.red, dg = colors[i].green - color.green, db = colors[i].blue - color.blue;
+        const int distance = dr * dr + dg * dg + db * db;
+        if (distance < bestDistance)
+        {
+            best = i;
+            bestDistance = distance;
+        }
+    }
+    return best;
+}
+
+static double squaredError(const Image &image, const Palette &palette)
+{
+    double total = 0;
+    const unsigned char *cell = image.data.get();
+    for (size_t i = 0; i < image.width * image.height; i++, cell += image.channels)
+    {
+        const Color color = cellColor(cell, image.channels);
+        const Color &nearest = palette.colors()[nearestIndex(palette.colors(), color)];
+        const int dr = nearest.red - color.red, dg = nearest.green - color.green, db = nearest.blue - color.blue;
+        total += dr * dr + dg * dg + db * db;
+    }
+    return total;
+}
+
+@interface PaletteTests : XCTestCase
+
+@end
+
+@implementation PaletteTests
+
+// median cut has a color for each well separated cluster and never goes outside the colors it
+// was given; a single color comes back as itself
+- (void)testMedianCut
+{
+    srand(47);
+    const std::vector<Color> centers = {Color(20, 30, 200), Color(220, 40, 40), Color(60, 210, 90), Color(240, 240, 230)};
+    const Image image = clusterImage(centers, 64, 48);
+    const size_t cellCount = image.width * image.height;
+    
+    for (size_t count : {1, 4, 9, 256})
+    {
+        const Palette palette = Palette::medianCut(image.data.get(), cellCount, 3, count);
+        XCTAssertTrue(palette.size() >= 1 && palette.size() <= count, @"%zu colors", count);
+        for (const Color &color : palette.colors())
+        {
+            XCTAssertTrue(color.red >= 16 && color.red <= 244 && color.green >= 26 && color.green <= 244 && color.blue >= 36 && color.blue <= 234);
+        }
+        
+        if (count >= centers.size())
+        {
+            for (const Color &center : centers)
+            {
+                const Color &nearest = palette.colors()[nearestIndex(palette.colors(), center)];
+                XCTAssertTrue(abs(nearest.red - center.red) <= 4 && abs(nearest.green - center.green) <= 4 && abs(nearest.blue - center.blue) <= 4, @"%zu colors", count);
+            }
+        }
+    }
+    
+    std::vector<unsigned char> flat(300 * 3);
+    for (size_t i = 0; i < flat.size(); i += 3)
+    {
+        flat[i] = 12;
+        flat[i + 1] = 34;
+        flat[i + 2] = 56;
+    }
+    const Palette single = Palette::medianCut(flat.data(), 300, 3, 16);
+    XCTAssertEqual(single.size(), (size_t)1);
+    XCTAssertTrue(single.colors()[0] == Color(12, 34, 56));
+}
+
+// k-means only ever moves colors to the mean of the cells nearest them, so it is never much
+// worse than the median cut it started from
+- (void)testKMeans
+{
+    srand(48);
+    const std::vector<Color> centers = {Color(10, 10, 10), Color(15, 20, 240), Color(250, 250, 250), Color(200, 100, 20), Color(30, 220, 30)};
+    const Image image = clusterImage(centers, 80, 60);
+    const size_t cellCount = image.width * image.height;
+    
+    for (size_t count : {2, 5, 12})
+    {
+        const Palette start = Palette::medianCut(image.data.get(), cellCount, 3, count);
+        const Palette refined = Palette::kMeans(image.data.get(), cellCount, 3, count);
+        XCTAssertEqual(refined.size(), start.size());
+        
+        // rounding each mean to whole steps can cost a little
+        XCTAssertTrue(squaredError(image, refined) <= squaredError(image, start) + cellCount, @"%zu colors", count);
+        
+        // with exactly one color per cluster, a start that put two colors in one cluster can't
+        // be left; with colors to spare every cluster gets one
+        if (count > 2 * centers.size())
+        {
+            for (const Color &center : centers)
+            {
+                const Color &nearest = refined.colors()[nearestIndex(refined.colors(), center)];
+                XCTAssertTrue(abs(nearest.red - center.red) <= 4 && abs(nearest.green - center.green) <= 4 && abs(nearest.blue - center.blue) <= 4, @"%zu colors", count);
+            }
+        }
+    }
+    
+    // one color has nothing to refine
+    XCTAssertEqual(Palette::kMeans(image.data.get(), cellCount, 3, 1).size(), (size_t)1);
+}
+
+// every cell gets the first of its nearest colors, from luminance, RGB and RGBA cells alike,
+// however many threads share the cells
+- (void)testAssign
+{
+    srand(49);
+    std::vector<Color> colors;
+    for (int i = 0; i < 40; i++)
+    {
+        colors.push_back(Color(rand() & 0xff, rand() & 0xff, rand() & 0xff));
+    }
+    colors.push_back(colors[3]);
+    colors.insert(colors.begin(), colors[17]);
+    const Palette palette(colors);
+    
+    for (int channels : {1, 3, 4})
+    {
+        const size_t cellCount = 5003;
+        std::vector<unsigned char> cells(cellCount * channels);
+        for (unsigned char &value : cells)
+        {
+            value = rand() & 0xff;
+        }
+        
+        std::vector<uint8_t> serial(cellCount);
+        palette.assign(cells.data(), cellCount, channels, serial.data(), 1);
+        size_t mismatches = 0;
+        for (size_t i = 0; i < cellCount; i++)
+        {
+            mismatches += serial[i] != nearestIndex(colors, cellColor(&cells[i * channels], channels));
+        }
+        XCTAssertEqual(mismatches, (size_t)0, @"%d channels", channels);
+        
+        for (size_t threads : {2, 3, 7})
+        {
+            std::vector<uint8_t> threaded(cellCount, 0xff);
+            palette.assign(cells.data(), cellCount, channels, threaded.data(), threads);
+            XCTAssertTrue(threaded == serial, @"%d channels, %zu threads", channels, threads);
+        }
+        
+        // fewer cells than threads
+        std::vector<uint8_t> few(2, 0xff);
+        palette.assign(cells.data(), 2, channels, few.data(), 7);
+        XCTAssertTrue(few[0] == serial[0] && few[1] == serial[1]);
+    }
+    
+    std::vector<uint8_t> unassigned(4, 0xff);
+    const unsigned char gray[4] = {1, 2, 3, 4};
+    Palette().assign(gray, 4, 1, unassigned.data());
+    XCTAssertTrue(unassigned == std::vector<uint8_t>(4, 0));
+}
+
+// cells already in the palette come back unchanged, others as their nearest color, and an
+// image quantized with no palette expands to nothing rather than reading past it
+- (void)testQuantizeRoundTrips
+{
+    srand(50);
+    std::vector<Color> colors;
+    for (int i = 0; i < 256; i++)
+    {
+        colors.push_back(Color(rand() & 0xff, rand() & 0xff, rand() & 0xff));
+    }
+    const Palette palette(colors);
+    
+    Image image = makeImage(37, 23, 3);
+    unsigned char *cell = image.data.get();
+    for (size_t i = 0; i < image.width * image.height; i++, cell += 3)
+    {
+        const Color &color = colors[rand() % colors.size()];
+        cell[0] = color.red;
+        cell[1] = color.green;
+        cell[2] = color.blue;
+    }
+    
+    const IndexedImage indexed = IndexedImage::quantize(image, palette);
+    XCTAssertEqual(indexed.indices.channels, 1);
+    const Image expanded = indexed.expanded();
+    XCTAssertEqual(expanded.width, image.width);
+    XCTAssertEqual(expanded.height, image.height);
+    XCTAssertEqual(expanded.channels, 3);
+    XCTAssertTrue(memcmp(expanded.data.get(), image.data.get(), image.width * image.height * 3) == 0);
+    
+    // a luminance image goes through gray cells
+    Image gray = makeImage(19, 11, 1);
+    for (size_t i = 0; i < gray.width * gray.height; i++)
+    {
+        gray.data.get()[i] = rand() & 0xff;
+    }
+    const Image grayExpanded = IndexedImage::quantize(gray, palette).expanded();
+    size_t mismatches = 0;
+    for (size_t i = 0; i < gray.width * gray.height; i++)
+    {
+        const Color &expected = colors[nearestIndex(colors, cellColor(&gray.data.get()[i], 1))];
+        mismatches += Color(&grayExpanded.data.get()[i * 3]) != expected;
+    }
+    XCTAssertEqual(mismatches, (size_t)0);
+    
+    const Image nothing = IndexedImage::quantize(image, Palette()).expanded();
+    XCTAssertEqual(nothing.width, (size_t)0);
+    XCTAssertEqual(nothing.height, (size_t)0);
+    XCTAssertTrue(nothing.data.get() == nullptr);
+}
+
+@end
@@ -0,0 +1,288 @@
+//
+//  PixelPointBenchmarks.mm
+//  PixelPointTests
+//
+//  Created by Kelsey Steeves on 2026-10-19.
+//  Copyright © 2026 Kelsey Steeves. All rights reserved.
+//
+
+#import <XCTest/XCTest.h>
+#import <CoreServices/CoreServices.h>
+#import <ImageIO/ImageIO.h>
+
+#include "GLTestContext.h"
+#include "Image.h"
+#include "PixelPointRenderer.h"
+#include "Scene.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+// a horizontal gradient with noise over it, so blocks don't average to the same value
+static Image gradientImage(size_t width, size_t height, int channels, unsigned seed)
+{
+    srand(seed);
+    unsigned char *data = (unsigned char *)malloc(width * height * channels);
+    for (size_t y = 0; y < height; y++)
+    {
+        for (size_t x = 0; x < width; x++)
+        {
+            for (int c = 0; c < channels; c++)
+            {
+                data[(y * width + x) * channels + c] = (unsigned char)((x * 255 / width + c * 40 + rand() % 24) & 0xff);
+            }
+        }
+    }
+    return Image(std::unique_ptr<unsigned char, decltype(&std::free)>(data, &std::free), width, height, channels);
+}
+
+// writes an image out through ImageIO, so loads can be timed from a real PNG or JPEG
+static std::string temporaryImageFile(const Image &image, CFStringRef type, const char *name)
+{
+    NSString *path = [NSTemporaryDirectory() stringByAppendingPathComponent:@(name)];
+    CGColorSpaceRef space = image.channels == 1 ? CGColorSpaceCreateDeviceGray() : CGColorSpaceCreateDeviceRGB();
+    CGDataProviderRef provider = CGDataProviderCreateWithData(NULL, image.data.get(), image.width * image.height * image.channels, NULL);
+    CGImageRef cgImage = CGImageCreate(image.width, image.height, 8, 8 * image.channels, image.width * image.channels, space, kCGImageAlphaNone, provider, NULL, false, kCGRenderingIntentDefault);
+    CGImageDestinationRef destination = CGImageDestinationCreateWithURL((__bridge CFURLRef)[NSURL fileURLWithPath:path], type, 1, NULL);
+    CGImageDestinationAddImage(destination, cgImage, NULL);
+    CGImageDestinationFinalize(destination);
+    
+    CFRelease(destination);
+    CGImageRelease(cgImage);
+    CGDataProviderRelease(provider);
+    CGColorSpaceRelease(space);
+    return [path UTF8String];
+}
+
+@interface PixelPointBenchmarks : XCTestCase
+
+@end
+
+@implementation PixelPointBenchmarks
+
+// a 3000 x 2000 photo scaled to cells, as RGB and as luminance. the luminance kernel reads a
+// third of the bytes
+- (void)testScaleRGB
+{
+    Image image = gradientImage(3000, 2000, 3, 30);
+    const Image *source = &image;
+    [self measureBlock:^{
+        Image scaled = Image::scaledFromSource(*source);
+        XCTAssertEqual(scaled.channels, 3);
+    }];
+}
+
+- (void)testScaleLuminance
+{
+    Image image = gradientImage(3000, 2000, 1, 30);
+    const Image *source = &image;
+    [self measureBlock:^{
+        Image scaled = Image::scaledFromLuminance(source->data.get(), source->width, source->height, 1, source->width);
+        XCTAssertEqual(scaled.channels, 1);
+    }];
+}
+
+// linear light goes through a table each way, and should take about as long as the squares
+- (void)testScaleRGBLinear
+{
+    Image image = gradientImage(3000, 2000, 3, 30);
+    const Image *source = &image;
+    [self measureBlock:^{
+        Image scaled = Image::scaledFromSource(*source, Image::Averaging::Linear);
+        XCTAssertEqual(scaled.channels, 3);
+    }];
+}
+
+- (void)testScaleLuminanceLinear
+{
+    Image image = gradientImage(3000, 2000, 1, 30);
+    const Image *source = &image;
+    [self measureBlock:^{
+        Image scaled = Image::scaledFromLuminance(source->data.get(), source->width, source->height, 1, source->width, Image::Averaging::Linear);
+        XCTAssertEqual(scaled.channels, 1);
+    }];
+}
+
+// loading and scaling a 3000 x 2000 file. grayscale PNGs stay single channel all the way and
+// grayscale JPEGs are averaged straight from the Y plane
+- (void)measureScaledLoad:(const char *)path averaging:(Image::Averaging)averaging
+{
+    const std::string file = path;
+    [self measureBlock:^{
+        Image scaled = Image::loadScaledImage(file.c_str(), false, averaging);
+        XCTAssertGreaterThan(scaled.width, (size_t)0);
+    }];
+}
+
+- (void)testLoadScaledPNG
+{
+    [self measureScaledLoad:temporaryImageFile(gradientImage(3000, 2000, 3, 31), kUTTypePNG, "benchmark.png").c_str() averaging:Image::Averaging::RootMeanSquare];
+}
+
+- (void)testLoadScaledGrayscalePNG
+{
+    [self measureScaledLoad:temporaryImageFile(gradientImage(3000, 2000, 1, 31), kUTTypePNG, "benchmark-gray.png").c_str() averaging:Image::Averaging::RootMeanSquare];
+}
+
+// color JPEGs convert every pixel to RGB on the way through, whichever way they average
+- (void)testLoadScaledJPEG
+{
+    [self measureScaledLoad:temporaryImageFile(gradientImage(3000, 2000, 3, 31), kUTTypeJPEG, "benchmark.jpg").c_str() averaging:Image::Averaging::RootMeanSquare];
+}
+
+- (void)testLoadScaledJPEGLinear
+{
+    [self measureScaledLoad:temporaryImageFile(gradientImage(3000, 2000, 3, 31), kUTTypeJPEG, "benchmark.jpg").c_str() averaging:Image::Averaging::Linear];
+}
+
+- (void)testLoadScaledGrayscaleJPEG
+{
+    [self measureScaledLoad:temporaryImageFile(gradientImage(3000, 2000, 1, 31), kUTTypeJPEG, "benchmark-gray.jpg").c_str() averaging:Image::Averaging::RootMeanSquare];
+}
+
+// streaming a 1024 x 1024 grid to the instanced renderer, three bytes per cell against one.
+// only the uploads are timed; drawing a million instances would drown out the difference
+- (void)streamCells:(int)channels
+{
+    GLTestContext context(64, 64);
+    XCTAssertTrue(context.valid());
+    
+    // blocks copy what they capture, so they get pointers
+    PixelPointRenderer renderer;
+    PixelPointRenderer *target = &renderer;
+    Image frames[] = {gradientImage(1024, 1024, channels, 1), gradientImage(1024, 1024, channels, 2)};
+    const Image *frame = frames;
+    renderer.loadTexture(frames[1]);
+    renderer.render();
+    glFinish();
+    
+    [self measureBlock:^{
+        for (int i = 0; i < 30; i++)
+        {
+            target->loadTexture(frame[i & 1]);
+        }
+        glFinish();
+    }];
+    
+    XCTAssertEqual(renderer.scene->luminance, channels == 1);
+    XCTAssertEqual(renderer.uploads.colorBytes, renderer.uploads.colorUploads * 1024 * 1024 * channels);
+}
+
+- (void)testStreamRGBCells
+{
+    [self streamCells:3];
+}
+
+- (void)testStreamLuminanceCells
+{
+    [self streamCells:1];
+}
+
+// rebuilding the grid from a new frame and uploading it, from the default 22 x 28 grid up to
+// 1024 x 1024. once every stream slot has storage for the size nothing allocates, on the CPU
+// or the GPU
+- (void)rebuildGrid:(size_t)width height:(size_t)height
+{
+    GLTestContext context(64, 64);
+    XCTAssertTrue(context.valid());
+    
+    PixelPointRenderer renderer;
+    PixelPointRenderer *target = &renderer;
+    Image frames[] = {gradientImage(width, height, 3, 1), gradientImage(width, height, 3, 2)};
+    const Image *frame = frames;
+    for (int i = 0; i < 3; i++)
+    {
+        renderer.loadTexture(frames[i & 1]);
+    }
+    glFinish();
+    
+    const size_t allocations = renderer.uploads.allocations;
+    const unsigned char *colors = renderer.scene->colors.data();
+    [self measureBlock:^{
+        for (int i = 0; i < 30; i++)
+        {
+            target->loadTexture(frame[i & 1]);
+        }
+        glFinish();
+    }];
+    
+    XCTAssertEqual(renderer.uploads.allocations, allocations);
+    XCTAssertTrue(renderer.scene->colors.data() == colors);
+}
+
+- (void)testRebuild22x28Grid
+{
+    [self rebuildGrid:28 height:22];
+}
+
+- (void)testRebuild256x192Grid
+{
+    [self rebuildGrid:256 height:192];
+}
+
+- (void)testRebuild1024x1024Grid
+{
+    [self rebuildGrid:1024 height:1024];
+}
+
+// edit operations on a 1024 x 1024 grid, each of which has to finish well inside a frame.
+// fills alternate between two colors so every run repaints the same cells
+- (void)testFloodFillWholeGrid
+{
+    Scene scene;
+    scene.load(gradientImage(1024, 1024, 3, 1));
+    scene.fill(Color(255, 255, 255));
+    
+    Scene *target = &scene;
+    __block int run = 0;
+    [self measureBlock:^{
+        const Color color = run++ & 1 ? Color(255, 255, 255) : Color(200, 40, 90);
+        XCTAssertEqual(target->floodFill(0, color), (size_t)1024 * 1024);
+        target->editedRanges.clear();
+    }];
+}
+
+// a corridor that winds across every other row, so each span seeds the next row from one end
+- (void)testFloodFillMaze
+{
+    Scene scene;
+    scene.load(gradientImage(1024, 1024, 3, 1));
+    scene.fill(Color(255, 255, 255));
+    
+    size_t corridor = 1024 * 1024;
+    for (size_t y = 1; y < 1024; y += 2)
+    {
+        // walls open at the right end and the left end in turn
+        const size_t gap = y % 4 == 1 ? 1023 : 0;
+        scene.fillRect(gap == 0 ? 1 : 0, y, 1023, 1, Color(0, 0, 0));
+        corridor -= 1023;
+    }
+    
+    Scene *target = &scene;
+    __block int run = 0;
+    [self measureBlock:^{
+        const Color color = run++ & 1 ? Color(255, 255, 255) : Color(200, 40, 90);
+        XCTAssertEqual(target->floodFill(0, color), corridor);
+        target->editedRanges.clear();
+    }];
+}
+
+- (void)testDrawLines
+{
+    Scene scene;
+    scene.load(gradientImage(1024, 1024, 3, 1));
+    
+    Scene *target = &scene;
+    [self measureBlock:^{
+        srand(43);
+        for (int i = 0; i < 1000; i++)
+        {
+            target->drawLine(rand() % 1024, rand() % 1024, rand() % 1024, rand() % 1024, Color(200, 40, 90));
+        }
+        XCTAssertFalse(target->editedRanges.empty());
+        target->editedRanges.clear();
+    }];
+}
+
+@end
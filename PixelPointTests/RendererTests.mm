@@ -0,0 +1,221 @@
+//
+//  RendererTests.mm
+//  PixelPointTests
+//
+//  Created by Kelsey Steeves on 2026-10-19.
+//  Copyright © 2026 Kelsey Steeves. All rights reserved.
+//
+
+#import <XCTest/XCTest.h>
+
+#include "GLTestContext.h"
+#include "Image.h"
+#include "PixelPointRenderer.h"
+
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+static Image noiseImage(size_t width, size_t height, int channels)
+{
+    unsigned char *data = (unsigned char *)malloc(width * height * channels);
+    for (size_t i = 0; i < width * height * channels; i++)
+    {
+        data[i] = rand() & 0xff;
+    }
+    return Image(std::unique_ptr<unsigned char, decltype(&std::free)>(data, &std::free), width, height, channels);
+}
+
+@interface RendererTests : XCTestCase
+
+@end
+
+@implementation RendererTests
+
+// Texture mode has to put every pixel where Quads mode does: grids whose cells land on whole
+// pixels and ones whose edges fall exactly on pixel centres, RGB and luminance, under every
+// rotation and flip the views use
+- (void)testTextureModeMatchesQuads
+{
+    // grid size, then viewport size
+    const int sizes[][4] = {{40, 30, 640, 480}, {31, 23, 496, 368}, {28, 22, 333, 251}, {37, 28, 800, 600}, {22, 28, 251, 333}, {13, 7, 999, 1001}, {3, 3, 300, 300}};
+    const float rotations[] = {0.0f, (float)M_PI_2, (float)-M_PI_2, (float)M_PI};
+    const bool flips[][2] = {{false, false}, {true, false}, {false, true}};
+    
+    srand(31);
+    for (const int *size : sizes)
+    {
+        GLTestContext context(size[2], size[3]);
+        XCTAssertTrue(context.valid());
+        
+        PixelPointRenderer quads(PixelPointRenderer::Mode::Quads), texture(PixelPointRenderer::Mode::Texture);
+        for (int channels = 1; channels <= 3; channels += 2)
+        {
+            Image image = noiseImage(size[0], size[1], channels);
+            quads.loadTexture(image);
+            texture.loadTexture(image);
+            
+            for (float rotation : rotations)
+            {
+                for (const bool *flip : flips)
+                {
+                    for (PixelPointRenderer *renderer : {&quads, &texture})
+                    {
+                        renderer->rotation = rotation;
+                        renderer->flip[0] = flip[0];
+                        renderer->flip[1] = flip[1];
+                    }
+                    
+                    quads.render();
+                    const std::vector<unsigned char> expected = context.readPixels();
+                    texture.render();
+                    const std::vector<unsigned char> pixels = context.readPixels();
+                    
+                    size_t differing = 0;
+                    for (size_t i = 0; i < pixels.size(); i++)
+                    {
+                        differing += pixels[i] != expected[i];
+                    }
+                    XCTAssertEqual(differing, (size_t)0, @"%dx%d grid in %dx%d, %d channels, rotation %.2f, flip %d %d", size[0], size[1], size[2], size[3], channels, rotation, flip[0], flip[1]);
+                }
+            }
+        }
+        XCTAssertEqual(glGetError(), GL_NO_ERROR);
+    }
+}
+
+// a half turn is the same picture as flipping both axes
+- (void)testQuadsModeRotates
+{
+    GLTestContext context(160, 120);
+    XCTAssertTrue(context.valid());
+    
+    srand(32);
+    PixelPointRenderer renderer;
+    renderer.loadTexture(noiseImage(16, 12, 3));
+    renderer.render();
+    const std::vector<unsigned char> upright = context.readPixels();
+    
+    renderer.flip[0] = renderer.flip[1] = true;
+    renderer.render();
+    const std::vector<unsigned char> flipped = context.readPixels();
+    
+    renderer.flip[0] = renderer.flip[1] = false;
+    renderer.rotation = M_PI;
+    renderer.render();
+    const std::vector<unsigned char> turned = context.readPixels();
+    
+    XCTAssertTrue(flipped != upright);
+    XCTAssertTrue(turned == flipped);
+}
+
+// edits go into the slot the last frame drew from, or with the whole stream into the next slot
+// while that draw is still running. either way every edit has to reach the screen
+- (void)testEditsReachTheScreen
+{
+    GLTestContext context(320, 240);
+    XCTAssertTrue(context.valid());
+    
+    srand(34);
+    PixelPointRenderer renderer;
+    renderer.loadTexture(noiseImage(40, 30, 3));
+    renderer.render();
+    
+    Scene &scene = *renderer.scene;
+    for (int frame = 0; frame < 60; frame++)
+    {
+        const PixelPointRenderer::UploadCounters before = renderer.uploads;
+        for (int i = 0; i < 8; i++)
+        {
+            scene.editCell(rand() % (40 * 30), Color(rand() & 0xff, rand() & 0xff, rand() & 0xff));
+        }
+        renderer.render();
+        
+        // a stalled flush sends the stream once, into a slot that may not have storage yet
+        const size_t streams = renderer.uploads.colorUploads + renderer.uploads.allocations - before.colorUploads - before.allocations;
+        XCTAssertTrue(renderer.uploads.editUploads > before.editUploads || (renderer.uploads.stalls > before.stalls && streams == 1));
+    }
+    const std::vector<unsigned char> pixels = context.readPixels();
+    
+    unsigned char *data = (unsigned char *)malloc(scene.colors.size());
+    memcpy(data, scene.colors.data(), scene.colors.size());
+    PixelPointRenderer reference;
+    reference.loadTexture(Image(std::unique_ptr<unsigned char, decltype(&std::free)>(data, &std::free), 40, 30, 3));
+    reference.render();
+    XCTAssertTrue(context.readPixels() == pixels);
+}
+
+// views make a renderer per context and drop it with the view, so they have to clean up after
+// themselves; glIsProgram and friends can't see into the renderer, GL errors can
+- (void)testRenderersCanBeReplaced
+{
+    GLTestContext context(64, 64);
+    XCTAssertTrue(context.valid());
+    
+    srand(39);
+    for (int i = 0; i < 20; i++)
+    {
+        PixelPointRenderer renderer(i & 1 ? PixelPointRenderer::Mode::Texture : PixelPointRenderer::Mode::Quads);
+        for (int frame = 0; frame < 4; frame++)
+        {
+            renderer.loadTexture(noiseImage(30, 20, 3));
+            renderer.scene->editCell(rand() % (30 * 20), Color(rand() & 0xff, 0, 0));
+            renderer.render();
+        }
+    }
+    XCTAssertEqual(glGetError(), GL_NO_ERROR);
+}
+
+// Texture mode draws the scene, so edits made to it have to show up like they do in Quads mode,
+// a few rows at a time, whether or not an overlay keeps them. each image follows another one
+// of the same size, so an edit over a scene that missed the newer image shows up too
+- (void)testTextureModeShowsEdits
+{
+    GLTestContext context(320, 240);
+    XCTAssertTrue(context.valid());
+    
+    srand(45);
+    for (int pass = 0; pass < 4; pass++)
+    {
+        const int channels = pass & 1 ? 3 : 1;
+        
+        // the overlay keeps edits over later images, so each image gets fresh renderers
+        PixelPointRenderer quads(PixelPointRenderer::Mode::Quads), texture(PixelPointRenderer::Mode::Texture);
+        if (pass >= 2)
+        {
+            texture.scene->enableOverlay();
+        }
+        
+        Image image = noiseImage(40, 30, channels);
+        for (PixelPointRenderer *renderer : {&quads, &texture})
+        {
+            renderer->loadTexture(noiseImage(40, 30, 3));
+            renderer->render();
+            renderer->loadTexture(image);
+        }
+        
+        for (int frame = 0; frame < 10; frame++)
+        {
+            const PixelPointRenderer::UploadCounters before = texture.uploads;
+            for (PixelPointRenderer *renderer : {&quads, &texture})
+            {
+                srand(frame);
+                renderer->scene->editCell(rand() % (40 * 30), Color(rand() & 0xff, rand() & 0xff, rand() & 0xff));
+                renderer->scene->drawLine(rand() % 40, rand() % 30, rand() % 40, rand() % 30, Color(200, 40, 90));
+            }
+            
+            quads.render();
+            const std::vector<unsigned char> expected = context.readPixels();
+            texture.render();
+            XCTAssertTrue(context.readPixels() == expected, @"pass %d, frame %d", pass, frame);
+            
+            // only rows go up, unless the last draw from the texture was still running. a
+            // luminance texture goes up whole, as RGB, at the first edit
+            XCTAssertTrue(texture.uploads.editUploads > before.editUploads || texture.uploads.stalls > before.stalls || (frame == 0 && channels == 1));
+        }
+    }
+    XCTAssertEqual(glGetError(), GL_NO_ERROR);
+}
+
+@end
@@ -0,0 +1,418 @@
+//
+//  SceneTests.mm
+//  PixelPointTests
+//
+//  Created by Kelsey Steeves on 2026-10-19.
+//  Copyright © 2026 Kelsey Steeves. All rights reserved.
+//
+
+#import <XCTest/XCTest.h>
+
+#include "Scene.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <vector>
+
+static const size_t WIDTH = 83;
+static const size_t HEIGHT = 61;
+
+// cells of a few colors, mostly in runs, so areas of one color wind around each other
+static void loadNoise(Scene &scene, size_t width, size_t height, int colorCount)
+{
+    std::vector<unsigned char> data(width * height * 3);
+    for (size_t i = 0; i < width * height; i++)
+    {
+        const int value = i > width && rand() % 3 ? data[(i - (rand() & 1 ? 1 : width)) * 3] / 60 : rand() % colorCount;
+        data[i * 3] = value * 60;
+        data[i * 3 + 1] = 255 - value * 60;
+        data[i * 3 + 2] = 30;
+    }
+    scene.load(data.data(), width, height, 3);
+}
+
+// the cells of the start cell's color that can be reached from it through edge neighbours
+static std::vector<bool> reachable(const Scene &scene, size_t start)
+{
+    std::vector<bool> seen(scene.width * scene.height, false);
+    const Color match = scene.colorAt(start);
+    std::deque<size_t> queue(1, start);
+    seen[start] = true;
+    while (!queue.empty())
+    {
+        const size_t cell = queue.front();
+        queue.pop_front();
+        const size_t x = cell % scene.width, y = cell / scene.width;
+        const size_t neighbours[] = {x > 0 ? cell - 1 : cell, x + 1 < scene.width ? cell + 1 : cell, y > 0 ? cell - scene.width : cell, y + 1 < scene.height ? cell + scene.width : cell};
+        for (size_t next : neighbours)
+        {
+            if (!seen[next] && scene.colorAt(next) == match)
+            {
+                seen[next] = true;
+                queue.push_back(next);
+            }
+        }
+    }
+    return seen;
+}
+
+// the cells a line set, found by drawing it in a color the grid doesn't have
+static std::vector<std::pair<long, long>> lineCells(Scene &scene, long x0, long y0, long x1, long y1)
+{
+    std::fill(scene.colors.begin(), scene.colors.end(), 0);
+    scene.drawLine(x0, y0, x1, y1, Color(255, 255, 255));
+    
+    std::vector<std::pair<long, long>> cells;
+    for (size_t cell = 0; cell < scene.width * scene.height; cell++)
+    {
+        if (scene.colors[cell * 3])
+        {
+            cells.push_back(std::make_pair((long)(cell % scene.width), (long)(cell / scene.width)));
+        }
+    }
+    return cells;
+}
+
+// the first cell, in row order, whose edges hold the point, checking every one
+static Quad scanForQuad(Scene &scene, float point[2])
+{
+    for (size_t cell = 0; cell < scene.width * scene.height; cell++)
+    {
+        const Quad quad = scene.quad(cell);
+        if (Quad::isPointInQuad(quad, point))
+        {
+            return quad;
+        }
+    }
+    return Quad();
+}
+
+// whether every cell that differs between two grids lies in one of the ranges queued for upload
+static bool rangesCover(const Scene &scene, const std::vector<unsigned char> &before)
+{
+    for (size_t cell = 0; cell < scene.width * scene.height; cell++)
+    {
+        if (memcmp(&scene.colors[cell * 3], &before[cell * 3], 3) == 0)
+        {
+            continue;
+        }
+        
+        bool covered = false;
+        for (const Scene::CellRange &range : scene.editedRanges)
+        {
+            covered = covered || (range.first <= cell && cell <= range.last);
+        }
+        if (!covered)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+// a rectangle edge, a start anywhere from on the grid to well past it, a size from nothing to
+// more than can ever fit
+static size_t anyOffset(size_t size)
+{
+    return rand() % 4 ? rand() % size : size + rand() % 8;
+}
+
+static size_t anyLength(size_t size)
+{
+    const int pick = rand() % 8;
+    return pick == 0 ? 0 : pick == 1 ? SIZE_MAX : rand() % (size + 10);
+}
+
+@interface SceneTests : XCTestCase
+
+@end
+
+@implementation SceneTests
+
+// each fill changes exactly the 4-connected area a breadth first search finds, never reaching
+// across a corner, and returns its size. fills run one after another on the same grid, so later
+// ones start from areas earlier ones merged
+- (void)testFloodFillMatchesSearch
+{
+    srand(43);
+    for (int colorCount : {2, 3, 5})
+    {
+        Scene scene;
+        loadNoise(scene, WIDTH, HEIGHT, colorCount);
+        
+        for (int fill = 0; fill < 60; fill++)
+        {
+            const size_t start = rand() % (WIDTH * HEIGHT);
+            const Color color((rand() % colorCount) * 60, 255 - (rand() % colorCount) * 60, 30);
+            
+            std::vector<unsigned char> expected = scene.colors;
+            size_t expectedCount = 0;
+            if (scene.colorAt(start) != color)
+            {
+                const std::vector<bool> area = reachable(scene, start);
+                for (size_t cell = 0; cell < area.size(); cell++)
+                {
+                    if (area[cell])
+                    {
+                        expected[cell * 3] = color.red;
+                        expected[cell * 3 + 1] = color.green;
+                        expected[cell * 3 + 2] = color.blue;
+                        expectedCount++;
+                    }
+                }
+            }
+            
+            scene.editedRanges.clear();
+            XCTAssertEqual(scene.floodFill(start, color), expectedCount, @"%d colors, fill %d", colorCount, fill);
+            XCTAssertTrue(scene.colors == expected, @"%d colors, fill %d", colorCount, fill);
+            XCTAssertEqual(scene.editedRanges.empty(), expectedCount == 0);
+        }
+        
+        const std::vector<unsigned char> before = scene.colors;
+        XCTAssertEqual(scene.floodFill(WIDTH * HEIGHT, Color(1, 2, 3)), (size_t)0);
+        XCTAssertTrue(scene.colors == before);
+    }
+}
+
+// a line sets one cell per step along its longer axis, from one end to the other, each touching
+// the last and within half a cell of the true line. ends off the grid draw just the part of the
+// same line that crosses it
+- (void)testLinesAreUnbroken
+{
+    srand(44);
+    Scene scene, large;
+    loadNoise(scene, WIDTH, HEIGHT, 2);
+    const long margin = 40;
+    loadNoise(large, WIDTH + 2 * margin, HEIGHT + 2 * margin, 2);
+    
+    for (int line = 0; line < 300; line++)
+    {
+        const long x0 = rand() % (WIDTH + 2 * margin) - margin, y0 = rand() % (HEIGHT + 2 * margin) - margin;
+        const long x1 = line % 10 == 0 ? x0 : rand() % (WIDTH + 2 * margin) - margin;
+        const long y1 = line % 15 == 0 ? y0 : rand() % (HEIGHT + 2 * margin) - margin;
+        
+        // the whole line, on a grid big enough to hold it
+        std::vector<std::pair<long, long>> whole = lineCells(large, x0 + margin, y0 + margin, x1 + margin, y1 + margin);
+        for (std::pair<long, long> &cell : whole)
+        {
+            cell.first -= margin;
+            cell.second -= margin;
+        }
+        
+        const long dx = std::abs(x1 - x0), dy = std::abs(y1 - y0);
+        XCTAssertEqual(whole.size(), (size_t)std::max(dx, dy) + 1, @"line %d", line);
+        XCTAssertTrue(std::find(whole.begin(), whole.end(), std::make_pair(x0, y0)) != whole.end());
+        XCTAssertTrue(std::find(whole.begin(), whole.end(), std::make_pair(x1, y1)) != whole.end());
+        
+        // one cell per step along the longer axis, near the true line, and touching the next
+        const bool steep = dy > dx;
+        std::sort(whole.begin(), whole.end(), [steep](const std::pair<long, long> &a, const std::pair<long, long> &b)
+        {
+            return steep ? a.second < b.second : a.first < b.first;
+        });
+        for (size_t i = 0; i < whole.size(); i++)
+        {
+            const long along = steep ? whole[i].second : whole[i].first;
+            const long across = steep ? whole[i].first : whole[i].second;
+            const long start = steep ? std::min(y0, y1) : std::min(x0, x1);
+            XCTAssertEqual(along, start + (long)i, @"line %d", line);
+            
+            const double t = std::max(dx, dy) == 0 ? 0.0 : (double)((steep ? whole[i].second - y0 : whole[i].first - x0)) / (steep ? y1 - y0 : x1 - x0);
+            const double ideal = steep ? x0 + t * (x1 - x0) : y0 + t * (y1 - y0);
+            XCTAssertLessThanOrEqual(std::abs(across - ideal), 0.5 + 1e-9, @"line %d", line);
+            
+            if (i > 0)
+            {
+                const long previous = steep ? whole[i - 1].first : whole[i - 1].second;
+                XCTAssertLessThanOrEqual(std::abs(across - previous), 1L, @"line %d", line);
+            }
+        }
+        
+        // on the real grid, the cells of the whole line that fall on it
+        std::vector<std::pair<long, long>> expected;
+        for (const std::pair<long, long> &cell : whole)
+        {
+            if (cell.first >= 0 && cell.second >= 0 && cell.first < (long)WIDTH && cell.second < (long)HEIGHT)
+            {
+                expected.push_back(cell);
+            }
+        }
+        std::vector<std::pair<long, long>> clipped = lineCells(scene, x0, y0, x1, y1);
+        std::sort(expected.begin(), expected.end());
+        std::sort(clipped.begin(), clipped.end());
+        XCTAssertTrue(clipped == expected, @"line %d", line);
+    }
+}
+
+// hit testing works out the cell instead of scanning for it, and has to agree with the scan
+// everywhere: inside cells, on and a float step either side of every edge, at the corners and
+// off the grid. cell sizes of 2 / width aren't exact in float for any of these grids
+- (void)testQuadAtMatchesScan
+{
+    srand(41);
+    const size_t sizes[][2] = {{3, 7}, {22, 28}, {33, 19}, {97, 61}};
+    for (const size_t *size : sizes)
+    {
+        Scene scene;
+        std::vector<unsigned char> data(size[0] * size[1] * 3);
+        scene.load(data.data(), size[0], size[1], 3);
+        
+        std::vector<std::pair<float, float>> points;
+        for (int i = 0; i < 2000; i++)
+        {
+            points.push_back(std::make_pair(rand() / (float)RAND_MAX * 2.2f - 1.1f, rand() / (float)RAND_MAX * 2.2f - 1.1f));
+        }
+        
+        // every vertical edge crossed at a random height, and every horizontal one at a random
+        // column, nudged a float step either way
+        for (size_t column = 0; column <= scene.width; column++)
+        {
+            const float edge = column * (2.0f / scene.width) - 1;
+            for (float x : {std::nextafter(edge, -2.0f), edge, std::nextafter(edge, 2.0f)})
+            {
+                points.push_back(std::make_pair(x, rand() / (float)RAND_MAX * 2.0f - 1.0f));
+                points.push_back(std::make_pair(x, 1.0f));
+                points.push_back(std::make_pair(x, -1.0f));
+            }
+        }
+        for (size_t row = 0; row <= scene.height; row++)
+        {
+            const float edge = 1 - row * (2.0f / scene.height);
+            for (float y : {std::nextafter(edge, -2.0f), edge, std::nextafter(edge, 2.0f)})
+            {
+                points.push_back(std::make_pair(rand() / (float)RAND_MAX * 2.0f - 1.0f, y));
+                points.push_back(std::make_pair(-1.0f, y));
+                points.push_back(std::make_pair(1.0f, y));
+            }
+        }
+        
+        size_t mismatches = 0;
+        for (const std::pair<float, float> &pair : points)
+        {
+            float point[2] = {pair.first, pair.second};
+            const Quad found = scene.quadAt(point);
+            const Quad expected = scanForQuad(scene, point);
+            mismatches += !(found == expected);
+        }
+        XCTAssertEqual(mismatches, (size_t)0, @"%zu x %zu", scene.width, scene.height);
+    }
+}
+
+// fills, recolors and copies checked cell by cell against writing the cells one at a time,
+// with regions starting off the grid, running past it and of sizes no grid has, and copies
+// within one scene overlapping themselves in every direction
+- (void)testBulkEditsMatchCellByCell
+{
+    srand(42);
+    Scene scene, other;
+    loadNoise(scene, WIDTH, HEIGHT, 4);
+    loadNoise(other, 37, 90, 4);
+    
+    for (int edit = 0; edit < 2000; edit++)
+    {
+        const std::vector<unsigned char> before = scene.colors;
+        std::vector<unsigned char> expected = before;
+        auto set = [&expected](size_t cell, const unsigned char *rgb)
+        {
+            memcpy(&expected[cell * 3], rgb, 3);
+        };
+        scene.editedRanges.clear();
+        
+        const Color color((rand() % 4) * 60, 255 - (rand() % 4) * 60, 30);
+        const unsigned char rgb[3] = {color.red, color.green, color.blue};
+        switch (edit % 4)
+        {
+            case 0:
+            {
+                const size_t x = anyOffset(WIDTH), y = anyOffset(HEIGHT), width = anyLength(WIDTH), height = anyLength(HEIGHT);
+                for (size_t cell = 0; cell < WIDTH * HEIGHT; cell++)
+                {
+                    const size_t cellX = cell % WIDTH, cellY = cell / WIDTH;
+                    if (cellX >= x && cellX - x < width && cellY >= y && cellY - y < height)
+                    {
+                        set(cell, rgb);
+                    }
+                }
+                scene.fillRect(x, y, width, height, color);
+                break;
+            }
+            case 1:
+            {
+                // from a color the grid may not have, to one it may already have
+                const Color from = rand() % 8 ? scene.colorAt(rand() % (WIDTH * HEIGHT)) : Color(1, 2, 3);
+                size_t matched = 0;
+                for (size_t cell = 0; cell < WIDTH * HEIGHT; cell++)
+                {
+                    if (from != color && scene.colorAt(cell) == from)
+                    {
+                        set(cell, rgb);
+                        matched++;
+                    }
+                }
+                if (from != color)
+                {
+                    XCTAssertEqual(scene.recolor(from, color), matched, @"edit %d", edit);
+                }
+                break;
+            }
+            case 2:
+            case 3:
+            {
+                // half the copies are within the scene; the source is read before anything is written
+                Scene *source = edit % 4 == 2 ? &scene : &other;
+                const std::vector<unsigned char> sourceColors = source->colors;
+                const size_t sourceX = anyOffset(source->width), sourceY = anyOffset(source->height);
+                const size_t x = anyOffset(WIDTH), y = anyOffset(HEIGHT), width = anyLength(WIDTH), height = anyLength(HEIGHT);
+                // no grid here is 200 cells on a side
+                for (size_t row = 0; row < std::min(height, (size_t)200); row++)
+                {
+                    for (size_t column = 0; column < std::min(width, (size_t)200); column++)
+                    {
+                        if (sourceX + column < source->width && sourceY + row < source->height && x + column < WIDTH && y + row < HEIGHT)
+                        {
+                            set((y + row) * WIDTH + x + column, &sourceColors[((sourceY + row) * source->width + sourceX + column) * 3]);
+                        }
+                    }
+                }
+                scene.copyRegion(*source, sourceX, sourceY, width, height, x, y);
+                break;
+            }
+        }
+        XCTAssertTrue(scene.colors == expected, @"edit %d", edit);
+        XCTAssertTrue(rangesCover(scene, before), @"edit %d", edit);
+    }
+    
+    scene.fill(Color(9, 8, 7));
+    XCTAssertEqual(scene.recolor(Color(9, 8, 7), Color(7, 8, 9)), WIDTH * HEIGHT);
+    XCTAssertEqual(scene.recolor(Color(9, 8, 7), Color(7, 8, 9)), (size_t)0);
+}
+
+// a region copied one cell in each direction within the same scene, where every row or every
+// cell it writes is one it has yet to read
+- (void)testOverlappingCopies
+{
+    srand(42);
+    const long shifts[][2] = {{1, 0}, {-1, 0}, {0, 1}, {0, -1}, {1, 1}, {-1, -1}, {1, -1}, {-1, 1}, {5, 3}, {-3, -5}};
+    for (const long *shift : shifts)
+    {
+        Scene scene;
+        loadNoise(scene, WIDTH, HEIGHT, 5);
+        const std::vector<unsigned char> before = scene.colors;
+        
+        const size_t sourceX = 10, sourceY = 10, width = WIDTH - 20, height = HEIGHT - 20;
+        const size_t x = sourceX + shift[0], y = sourceY + shift[1];
+        std::vector<unsigned char> expected = before;
+        for (size_t row = 0; row < height; row++)
+        {
+            memcpy(&expected[((y + row) * WIDTH + x) * 3], &before[((sourceY + row) * WIDTH + sourceX) * 3], width * 3);
+        }
+        
+        scene.copyRegion(scene, sourceX, sourceY, width, height, x, y);
+        XCTAssertTrue(scene.colors == expected, @"shift %ld, %ld", shift[0], shift[1]);
+    }
+}
+
+@end
@@ -416,8 +416,8 @@ void
 
 /**
 	This function resturn a pointer to a string describing the last thing
-	that happened inside SOIL.  It can be used to determine why an image
-	failed to load.
+	that happened inside SOIL on the calling thread.  It can be used to
+	determine why an image failed to load.
 **/
 const char*
 	SOIL_last_result
@@ -109,13 +109,109 @@ typedef unsigned char validate_uint32[sizeof(uint32)==4];
 //	I (JLD) want full messages for SOIL
 #define STBI_FAILURE_USERMSG 1
 
+// one-time initialization of shared tables, a lock for the loader table, and
+// worker threads for the parallel JPEG decode
+#ifdef _WIN32
+   #define WIN32_LEAN_AND_MEAN
+   #include <windows.h>
+   typedef INIT_ONCE stbi_once_t;
+   #define STBI_ONCE_INIT  INIT_ONCE_STATIC_INIT
+   static BOOL CALLBACK once_thunk(PINIT_ONCE once, PVOID func, PVOID *unused)
+   {
+      ((void (*)(void)) func)();
+      return TRUE;
+   }
+   static void stbi_once(stbi_once_t *once, void (*func)(void))
+   {
+      InitOnceExecuteOnce(once, once_thunk, (PVOID) func, NULL);
+   }
+   static SRWLOCK loader_lock = SRWLOCK_INIT;
+   #define lock_loaders()     AcquireSRWLockExclusive(&loader_lock)
+   #define unlock_loaders()   ReleaseSRWLockExclusive(&loader_lock)
+
+   typedef struct
+   {
+      void (*func)(void *);
+      void *arg;
+      HANDLE handle;
+   } stbi_thread;
+   static DWORD WINAPI thread_thunk(LPVOID arg)
+   {
+      stbi_thread *t = (stbi_thread *) arg;
+      t->func(t->arg);
+      return 0;
+   }
+   static int thread_start(stbi_thread *t)
+   {
+      t->handle = CreateThread(NULL, 0, thread_thunk, t, 0, NULL);
+      return t->handle != NULL;
+   }
+   static void thread_join(stbi_thread *t)
+   {
+      WaitForSingleObject(t->handle, INFINITE);
+      CloseHandle(t->handle);
+   }
+   static int cpu_count(void)
+   {
+      SYSTEM_INFO info;
+      GetSystemInfo(&info);
+      return (int) info.dwNumberOfProcessors;
+   }
+#else
+   #include <pthread.h>
+   typedef pthread_once_t stbi_once_t;
+   #define STBI_ONCE_INIT  PTHREAD_ONCE_INIT
+   #define stbi_once(once, func)   pthread_once(once, func)
+   static pthread_mutex_t loader_lock = PTHREAD_MUTEX_INITIALIZER;
+   #define lock_loaders()     pthread_mutex_lock(&loader_lock)
+   #define unlock_loaders()   pthread_mutex_unlock(&loader_lock)
+
+   #include <unistd.h>
+   typedef struct
+   {
+      void (*func)(void *);
+      void *arg;
+      pthread_t handle;
+   } stbi_thread;
+   static void *thread_thunk(void *arg)
+   {
+      stbi_thread *t = (stbi_thread *) arg;
+      t->func(t->arg);
+      return NULL;
+   }
+   static int thread_start(stbi_thread *t)
+   {
+      return pthread_create(&t->handle, NULL, thread_thunk, t) == 0;
+   }
+   static void thread_join(stbi_thread *t)
+   {
+      pthread_join(t->handle, NULL);
+   }
+   static int cpu_count(void)
+   {
+      long n = sysconf(_SC_NPROCESSORS_ONLN);
+      return n > 0 ? (int) n : 1;
+   }
+#endif
+
 //////////////////////////////////////////////////////////////////////////////
 //
 // Generic API that works on all image types
 //
 
-// this is not threadsafe
-static char *failure_reason;
+// per thread, so concurrent loads don't see each other's errors
+static STBI_THREAD_LOCAL char *failure_reason;
+
+// the context of the stbi_*_ctx call running on this thread, if any
+static STBI_THREAD_LOCAL stbi_context *active_ctx;
+
+// settings for loads that aren't given a context
+static stbi_context default_ctx = { 1.0f/2.2f, 1.0f, 2.2f, 1.0f, 1, 0, NULL };
+
+static stbi_context *settings(void)
+{
+   return active_ctx ? active_ctx : &default_ctx;
+}
 
 char *stbi_failure_reason(void)
 {
@@ -125,6 +221,7 @@ char *stbi_failure_reason(void)
 static int e(char *str)
 {
    failure_reason = str;
+   if (active_ctx) active_ctx->failure_reason = str;
    return 0;
 }
 
@@ -150,20 +247,36 @@ static int max_loaders = 0;
 
 int stbi_register_loader(stbi_loader *loader)
 {
-   int i;
+   int i, added = 0;
+   lock_loaders();
    for (i=0; i < MAX_LOADERS; ++i) {
       // already present?
-      if (loaders[i] == loader)
-         return 1;
+      if (loaders[i] == loader) {
+         added = 1;
+         break;
+      }
       // end of the list?
       if (loaders[i] == NULL) {
          loaders[i] = loader;
          max_loaders = i+1;
-         return 1;
+         added = 1;
+         break;
       }
    }
-   // no room for it
-   return 0;
+   unlock_loaders();
+   // no room for it if not added
+   return added;
+}
+
+// entries below the count are never changed once set, so callers can walk
+// them without holding the lock
+static int loader_count(void)
+{
+   int n;
+   lock_loaders();
+   n = max_loaders;
+   unlock_loaders();
+   return n;
 }
 
 #ifndef STBI_NO_HDR
@@ -184,7 +297,7 @@ unsigned char *stbi_load(char const *filename, int *x, int *y, int *comp, int re
 
 unsigned char *stbi_load_from_file(FILE *f, int *x, int *y, int *comp, int req_comp)
 {
-   int i;
+   int i, n;
    if (stbi_jpeg_test_file(f))
       return stbi_jpeg_load_from_file(f,x,y,comp,req_comp);
    if (stbi_png_test_file(f))
@@ -203,7 +316,7 @@ unsigned char *stbi_load_from_file(FILE *f, int *x, int *y, int *comp, int req_c
       return hdr_to_ldr(hdr, *x, *y, req_comp ? req_comp : *comp);
    }
    #endif
-   for (i=0; i < max_loaders; ++i)
+   for (i=0, n=loader_count(); i < n; ++i)
       if (loaders[i]->test_file(f))
          return loaders[i]->load_from_file(f,x,y,comp,req_comp);
    // test tga last because it's a crappy test!
@@ -215,7 +328,7 @@ unsigned char *stbi_load_from_file(FILE *f, int *x, int *y, int *comp, int req_c
 
 unsigned char *stbi_load_from_memory(stbi_uc const *buffer, int len, int *x, int *y, int *comp, int req_comp)
 {
-   int i;
+   int i, n;
    if (stbi_jpeg_test_memory(buffer,len))
       return stbi_jpeg_load_from_memory(buffer,len,x,y,comp,req_comp);
    if (stbi_png_test_memory(buffer,len))
@@ -234,7 +347,7 @@ unsigned char *stbi_load_from_memory(stbi_uc const *buffer, int len, int *x, int
       return hdr_to_ldr(hdr, *x, *y, req_comp ? req_comp : *comp);
    }
    #endif
-   for (i=0; i < max_loaders; ++i)
+   for (i=0, n=loader_count(); i < n; ++i)
       if (loaders[i]->test_memory(buffer,len))
          return loaders[i]->load_from_memory(buffer,len,x,y,comp,req_comp);
    // test tga last because it's a crappy test!
@@ -243,6 +356,49 @@ unsigned char *stbi_load_from_memory(stbi_uc const *buffer, int len, int *x, int
    return epuc("unknown image type", "Image not of any known type, or corrupt");
 }
 
+void stbi_context_init(stbi_context *ctx)
+{
+   *ctx = default_ctx;
+   ctx->failure_reason = NULL;
+}
+
+// the loaders read settings and report errors through active_ctx, so a
+// context call just installs its context for the duration of the load
+unsigned char *stbi_load_from_memory_ctx(stbi_context *ctx, stbi_uc const *buffer, int len, int *x, int *y, int *comp, int req_comp)
+{
+   stbi_context *outer = active_ctx;
+   unsigned char *result;
+   ctx->failure_reason = NULL;
+   active_ctx = ctx;
+   result = stbi_load_from_memory(buffer,len,x,y,comp,req_comp);
+   active_ctx = outer;
+   return result;
+}
+
+#ifndef STBI_NO_STDIO
+unsigned char *stbi_load_from_file_ctx(stbi_context *ctx, FILE *f, int *x, int *y, int *comp, int req_comp)
+{
+   stbi_context *outer = active_ctx;
+   unsigned char *result;
+   ctx->failure_reason = NULL;
+   active_ctx = ctx;
+   result = stbi_load_from_file(f,x,y,comp,req_comp);
+   active_ctx = outer;
+   return result;
+}
+
+unsigned char *stbi_load_ctx(stbi_context *ctx, char const *filename, int *x, int *y, int *comp, int req_comp)
+{
+   stbi_context *outer = active_ctx;
+   unsigned char *result;
+   ctx->failure_reason = NULL;
+   active_ctx = ctx;
+   result = stbi_load(filename,x,y,comp,req_comp);
+   active_ctx = outer;
+   return result;
+}
+#endif
+
 #ifndef STBI_NO_HDR
 
 #ifndef STBI_NO_STDIO
@@ -328,14 +484,11 @@ extern int      stbi_info_from_file  (FILE *f,                  int *x, int *y,
 extern int      stbi_info_from_memory(stbi_uc const *buffer, int len, int *x, int *y, int *comp);
 
 #ifndef STBI_NO_HDR
-static float h2l_gamma_i=1.0f/2.2f, h2l_scale_i=1.0f;
-static float l2h_gamma=2.2f, l2h_scale=1.0f;
+void   stbi_hdr_to_ldr_gamma(float gamma) { default_ctx.h2l_gamma_i = 1/gamma; }
+void   stbi_hdr_to_ldr_scale(float scale) { default_ctx.h2l_scale_i = 1/scale; }
 
-void   stbi_hdr_to_ldr_gamma(float gamma) { h2l_gamma_i = 1/gamma; }
-void   stbi_hdr_to_ldr_scale(float scale) { h2l_scale_i = 1/scale; }
-
-void   stbi_ldr_to_hdr_gamma(float gamma) { l2h_gamma = gamma; }
-void   stbi_ldr_to_hdr_scale(float scale) { l2h_scale = scale; }
+void   stbi_ldr_to_hdr_gamma(float gamma) { default_ctx.l2h_gamma = gamma; }
+void   stbi_ldr_to_hdr_scale(float scale) { default_ctx.l2h_scale = scale; }
 #endif
 
 
@@ -515,6 +668,7 @@ static unsigned char *convert_format(unsigned char *data, int img_n, int req_com
 static float   *ldr_to_hdr(stbi_uc *data, int x, int y, int comp)
 {
    int i,k,n;
+   float l2h_gamma = settings()->l2h_gamma, l2h_scale = settings()->l2h_scale;
    float *output = (float *) malloc(x * y * comp * sizeof(float));
    if (output == NULL) { free(data); return epf("outofmem", "Out of memory"); }
    // compute number of non-alpha components
@@ -533,6 +687,7 @@ static float   *ldr_to_hdr(stbi_uc *data, int x, int y, int comp)
 static stbi_uc *hdr_to_ldr(float   *data, int x, int y, int comp)
 {
    int i,k,n;
+   float h2l_gamma_i = settings()->h2l_gamma_i, h2l_scale_i = settings()->h2l_scale_i;
    stbi_uc *output = (stbi_uc *) malloc(x * y * comp);
    if (output == NULL) { free(data); return epuc("outofmem", "Out of memory"); }
    // compute number of non-alpha components
@@ -634,6 +789,14 @@ typedef struct
 
    int scan_n, order[4];
    int restart_interval, todo;
+
+   #ifndef STBI_NO_STDIO
+   // a file being decoded in parallel is read into memory first; these
+   // let cleanup_jpeg put the file position back where serial decode would
+   uint8 *file_copy;
+   FILE  *file_src;
+   long   file_pos;
+   #endif
 } jpeg;
 
 static int build_huffman(huffman *h, int *count)
@@ -1017,11 +1180,23 @@ static void reset(jpeg *j)
    // since we don't even allow 1<<30 pixels
 }
 
-static int parse_entropy_coded_data(jpeg *z)
+// number of MCUs in the current scan; a non-interleaved scan has one block
+// per MCU, in trivial scanline order over that component's pixels
+static int scan_mcu_count(jpeg *z)
 {
-   reset(z);
    if (z->scan_n == 1) {
-      int i,j;
+      int n = z->order[0];
+      return ((z->img_comp[n].x+7) >> 3) * ((z->img_comp[n].y+7) >> 3);
+   }
+   return z->img_mcu_x * z->img_mcu_y;
+}
+
+// decode MCUs [first,end) of the scan, starting from the current bitstream
+// position and restart state
+static int decode_mcus(jpeg *z, int first, int end)
+{
+   int m;
+   if (z->scan_n == 1) {
       #if STBI_SIMD
       __declspec(align(16))
       #endif
@@ -1032,63 +1207,218 @@ static int parse_entropy_coded_data(jpeg *z)
       // number of blocks to do just depends on how many actual "pixels" this
       // component has, independent of interleaved MCU blocking and such
       int w = (z->img_comp[n].x+7) >> 3;
-      int h = (z->img_comp[n].y+7) >> 3;
-      for (j=0; j < h; ++j) {
-         for (i=0; i < w; ++i) {
-            if (!decode_block(z, data, z->huff_dc+z->img_comp[n].hd, z->huff_ac+z->img_comp[n].ha, n)) return 0;
-            #if STBI_SIMD
-            stbi_idct_installed(z->img_comp[n].data+z->img_comp[n].w2*j*8+i*8, z->img_comp[n].w2, data, z->dequant2[z->img_comp[n].tq]);
-            #else
-            idct_block(z->img_comp[n].data+z->img_comp[n].w2*j*8+i*8, z->img_comp[n].w2, data, z->dequant[z->img_comp[n].tq]);
-            #endif
-            // every data block is an MCU, so countdown the restart interval
-            if (--z->todo <= 0) {
-               if (z->code_bits < 24) grow_buffer_unsafe(z);
-               // if it's NOT a restart, then just bail, so we get corrupt data
-               // rather than no data
-               if (!RESTART(z->marker)) return 1;
-               reset(z);
-            }
+      for (m=first; m < end; ++m) {
+         int i = m % w, j = m / w;
+         if (!decode_block(z, data, z->huff_dc+z->img_comp[n].hd, z->huff_ac+z->img_comp[n].ha, n)) return 0;
+         #if STBI_SIMD
+         stbi_idct_installed(z->img_comp[n].data+z->img_comp[n].w2*j*8+i*8, z->img_comp[n].w2, data, z->dequant2[z->img_comp[n].tq]);
+         #else
+         idct_block(z->img_comp[n].data+z->img_comp[n].w2*j*8+i*8, z->img_comp[n].w2, data, z->dequant[z->img_comp[n].tq]);
+         #endif
+         // every data block is an MCU, so countdown the restart interval
+         if (--z->todo <= 0) {
+            if (z->code_bits < 24) grow_buffer_unsafe(z);
+            // if it's NOT a restart, then just bail, so we get corrupt data
+            // rather than no data
+            if (!RESTART(z->marker)) return 1;
+            reset(z);
          }
       }
    } else { // interleaved!
-      int i,j,k,x,y;
+      int k,x,y;
       short data[64];
-      for (j=0; j < z->img_mcu_y; ++j) {
-         for (i=0; i < z->img_mcu_x; ++i) {
-            // scan an interleaved mcu... process scan_n components in order
-            for (k=0; k < z->scan_n; ++k) {
-               int n = z->order[k];
-               // scan out an mcu's worth of this component; that's just determined
-               // by the basic H and V specified for the component
-               for (y=0; y < z->img_comp[n].v; ++y) {
-                  for (x=0; x < z->img_comp[n].h; ++x) {
-                     int x2 = (i*z->img_comp[n].h + x)*8;
-                     int y2 = (j*z->img_comp[n].v + y)*8;
-                     if (!decode_block(z, data, z->huff_dc+z->img_comp[n].hd, z->huff_ac+z->img_comp[n].ha, n)) return 0;
-                     #if STBI_SIMD
-                     stbi_idct_installed(z->img_comp[n].data+z->img_comp[n].w2*y2+x2, z->img_comp[n].w2, data, z->dequant2[z->img_comp[n].tq]);
-                     #else
-                     idct_block(z->img_comp[n].data+z->img_comp[n].w2*y2+x2, z->img_comp[n].w2, data, z->dequant[z->img_comp[n].tq]);
-                     #endif
-                  }
+      for (m=first; m < end; ++m) {
+         int i = m % z->img_mcu_x, j = m / z->img_mcu_x;
+         // scan an interleaved mcu... process scan_n components in order
+         for (k=0; k < z->scan_n; ++k) {
+            int n = z->order[k];
+            // scan out an mcu's worth of this component; that's just determined
+            // by the basic H and V specified for the component
+            for (y=0; y < z->img_comp[n].v; ++y) {
+               for (x=0; x < z->img_comp[n].h; ++x) {
+                  int x2 = (i*z->img_comp[n].h + x)*8;
+                  int y2 = (j*z->img_comp[n].v + y)*8;
+                  if (!decode_block(z, data, z->huff_dc+z->img_comp[n].hd, z->huff_ac+z->img_comp[n].ha, n)) return 0;
+                  #if STBI_SIMD
+                  stbi_idct_installed(z->img_comp[n].data+z->img_comp[n].w2*y2+x2, z->img_comp[n].w2, data, z->dequant2[z->img_comp[n].tq]);
+                  #else
+                  idct_block(z->img_comp[n].data+z->img_comp[n].w2*y2+x2, z->img_comp[n].w2, data, z->dequant[z->img_comp[n].tq]);
+                  #endif
                }
             }
-            // after all interleaved components, that's an interleaved MCU,
-            // so now count down the restart interval
-            if (--z->todo <= 0) {
-               if (z->code_bits < 24) grow_buffer_unsafe(z);
-               // if it's NOT a restart, then just bail, so we get corrupt data
-               // rather than no data
-               if (!RESTART(z->marker)) return 1;
-               reset(z);
-            }
+         }
+         // after all interleaved components, that's an interleaved MCU,
+         // so now count down the restart interval
+         if (--z->todo <= 0) {
+            if (z->code_bits < 24) grow_buffer_unsafe(z);
+            // if it's NOT a restart, then just bail, so we get corrupt data
+            // rather than no data
+            if (!RESTART(z->marker)) return 1;
+            reset(z);
          }
       }
    }
    return 1;
 }
 
+// Parallel decode across restart intervals. Each interval starts with reset
+// DC predictions and an empty bit buffer, so once the RST markers have been
+// found, every interval can be decoded on its own into its own MCUs.
+
+// images smaller than this aren't worth starting threads for
+#define JPEG_PARALLEL_MIN_PIXELS   (512*512)
+#define JPEG_MAX_THREADS           32
+
+typedef struct
+{
+   jpeg z;              // private copy: bit buffer, dc predictions, stream bounds
+   uint8 **seg_start;   // interval k is [seg_start[k], seg_end[k])
+   uint8 **seg_end;
+   int first, last;     // intervals this worker decodes
+   char *failure;       // failure reason if one of them failed
+} jpeg_worker;
+
+static void jpeg_worker_run(void *arg)
+{
+   jpeg_worker *w = (jpeg_worker *) arg;
+   int k, total = scan_mcu_count(&w->z);
+   for (k=w->first; k < w->last; ++k) {
+      int first = k * w->z.restart_interval;
+      int end = first + w->z.restart_interval;
+      if (end > total) end = total;
+      w->z.s.img_buffer = w->seg_start[k];
+      w->z.s.img_buffer_end = w->seg_end[k];
+      reset(&w->z);
+      if (!decode_mcus(&w->z, first, end)) {
+         // the failure reason is per thread, so carry it back by hand
+         w->failure = stbi_failure_reason();
+         return;
+      }
+   }
+}
+
+// find where each restart interval's entropy data starts and ends; returns
+// 0 if the markers aren't exactly the expected RST0..7 sequence, in which
+// case the serial decoder deals with whatever is there. Each interval ends
+// just after the marker that follows it, so the bit reader runs into that
+// marker exactly as it does when decoding serially
+static int index_restart_intervals(jpeg *z, int count, uint8 **seg_start, uint8 **seg_end, uint8 **scan_end)
+{
+   uint8 *p = z->s.img_buffer, *end = z->s.img_buffer_end;
+   int k = 0;
+   seg_start[0] = p;
+   for (;;) {
+      p = (uint8 *) memchr(p, 0xff, end - p);
+      if (!p || p+1 >= end) return 0;
+      if (p[1] == 0x00) { p += 2; continue; } // stuffed byte
+      if (!RESTART(p[1])) break;              // marker that ends the scan
+      if (p[1] != 0xd0 + (k & 7) || k+1 >= count) return 0;
+      seg_end[k++] = p+2;
+      seg_start[k] = p += 2;
+   }
+   if (k+1 != count) return 0;
+   seg_end[k] = p+2;
+   *scan_end = p;
+   return 1;
+}
+
+#ifndef STBI_NO_STDIO
+// read the rest of the file so the intervals can be found and shared
+static int buffer_jpeg_file(jpeg *z)
+{
+   FILE *f = z->s.img_file;
+   long pos = ftell(f), len;
+   if (pos < 0 || fseek(f, 0, SEEK_END) != 0) return 0;
+   len = ftell(f) - pos;
+   fseek(f, pos, SEEK_SET);
+   if (len <= 0) return 0;
+   z->file_copy = (uint8 *) malloc(len);
+   if (!z->file_copy) return 0;
+   if (fread(z->file_copy, 1, len, f) != (size_t) len) {
+      free(z->file_copy);
+      z->file_copy = NULL;
+      fseek(f, pos, SEEK_SET);
+      return 0;
+   }
+   z->file_src = f;
+   z->file_pos = pos;
+   start_mem(&z->s, z->file_copy, (int) len);
+   return 1;
+}
+#endif
+
+// returns -1 if the scan should be decoded serially instead
+static int parse_entropy_coded_data_parallel(jpeg *z)
+{
+   int total = scan_mcu_count(z), count, threads, t, result = 1;
+   uint8 **seg, *scan_end;
+   jpeg_worker *workers;
+   stbi_thread *thread;
+
+   if (!z->restart_interval || z->s.img_x * z->s.img_y < JPEG_PARALLEL_MIN_PIXELS) return -1;
+   count = (total + z->restart_interval-1) / z->restart_interval;
+   threads = settings()->jpeg_threads ? settings()->jpeg_threads : cpu_count();
+   if (threads > count) threads = count;
+   if (threads > JPEG_MAX_THREADS) threads = JPEG_MAX_THREADS;
+   if (threads < 2) return -1;
+
+   #ifndef STBI_NO_STDIO
+   if (z->s.img_file && !buffer_jpeg_file(z)) return -1;
+   #endif
+
+   seg = (uint8 **) malloc(2 * count * sizeof(*seg));
+   workers = (jpeg_worker *) malloc(threads * sizeof(*workers));
+   thread = (stbi_thread *) malloc(threads * sizeof(*thread));
+   if (!seg || !workers || !thread || !index_restart_intervals(z, count, seg, seg+count, &scan_end)) {
+      free(seg); free(workers); free(thread);
+      return -1;
+   }
+
+   // contiguous runs of intervals, so each worker writes a band of MCU rows
+   for (t=0; t < threads; ++t) {
+      jpeg_worker *w = &workers[t];
+      w->z = *z;
+      w->seg_start = seg;
+      w->seg_end = seg+count;
+      w->first = (int) ((long long) count * t / threads);
+      w->last = (int) ((long long) count * (t+1) / threads);
+      w->failure = NULL;
+      thread[t].func = jpeg_worker_run;
+      thread[t].arg = w;
+   }
+   // worker 0 runs on this thread; any worker that can't get a thread too
+   for (t=1; t < threads; ++t)
+      if (!thread_start(&thread[t])) thread[t].func = NULL;
+   jpeg_worker_run(&workers[0]);
+   for (t=1; t < threads; ++t) {
+      if (thread[t].func) thread_join(&thread[t]);
+      else jpeg_worker_run(&workers[t]);
+   }
+   for (t=0; t < threads; ++t)
+      if (workers[t].failure) { failure_reason = workers[t].failure; result = 0; break; }
+   if (!result && active_ctx) active_ctx->failure_reason = failure_reason;
+
+   // carry on after the scan as if it had been decoded serially
+   z->s.img_buffer = scan_end;
+   reset(z);
+   free(seg); free(workers); free(thread);
+   return result;
+}
+
+static int parse_entropy_coded_data(jpeg *z)
+{
+   int result;
+   reset(z);
+   result = parse_entropy_coded_data_parallel(z);
+   if (result >= 0) return result;
+   return decode_mcus(z, 0, scan_mcu_count(z));
+}
+
+void stbi_jpeg_set_threads(int threads)
+{
+   default_ctx.jpeg_threads = threads;
+}
+
 static int process_marker(jpeg *z, int m)
 {
    int L;
@@ -1421,6 +1751,15 @@ void stbi_install_YCbCr_to_RGB(stbi_YCbCr_to_RGB_run func)
 static void cleanup_jpeg(jpeg *j)
 {
    int i;
+   #ifndef STBI_NO_STDIO
+   if (j->file_copy) {
+      if (j->s.img_buffer > j->s.img_buffer_end) j->s.img_buffer = j->s.img_buffer_end;
+      fseek(j->file_src, j->file_pos + (long) (j->s.img_buffer - j->file_copy), SEEK_SET);
+      free(j->file_copy);
+      j->file_copy = NULL;
+      j->s.img_file = j->file_src;
+   }
+   #endif
    for (i=0; i < j->s.img_n; ++i) {
       if (j->img_comp[i].data) {
          free(j->img_comp[i].raw_data);
@@ -1449,6 +1788,9 @@ static uint8 *load_jpeg_image(jpeg *z, int *out_x, int *out_y, int *comp, int re
    // validate req_comp
    if (req_comp < 0 || req_comp > 4) return epuc("bad req_comp", "Internal error");
    z->s.img_n = 0;
+   #ifndef STBI_NO_STDIO
+   z->file_copy = NULL;
+   #endif
 
    // load a jpeg image from whichever source
    if (!decode_jpeg_image(z)) { cleanup_jpeg(z); return NULL; }
@@ -1569,6 +1911,73 @@ unsigned char *stbi_jpeg_load_from_memory(stbi_uc const *buffer, int len, int *x
    return load_jpeg_image(&j, x,y,comp,req_comp);
 }
 
+// decode to the component planes at their own resolution, skipping the
+// chroma upsampling and color conversion in load_jpeg_image
+static int load_jpeg_planes(jpeg *z, stbi_jpeg_planes *p)
+{
+   int k;
+   z->s.img_n = 0;
+   #ifndef STBI_NO_STDIO
+   z->file_copy = NULL;
+   #endif
+   if (!decode_jpeg_image(z)) { cleanup_jpeg(z); return 0; }
+   // a plane's sample has to cover a whole number of pixels (h=3 against h=2 doesn't)
+   for (k=0; k < z->s.img_n; ++k) {
+      if (z->img_h_max % z->img_comp[k].h || z->img_v_max % z->img_comp[k].v) {
+         cleanup_jpeg(z);
+         return e("uneven sampling","JPEG sampling factors don't divide");
+      }
+   }
+   memset(p, 0, sizeof(*p));
+   p->x = z->s.img_x;
+   p->y = z->s.img_y;
+   p->n = z->s.img_n;
+   for (k=0; k < z->s.img_n; ++k) {
+      p->data[k]   = z->img_comp[k].data;
+      p->raw[k]    = z->img_comp[k].raw_data;
+      p->stride[k] = z->img_comp[k].w2;
+      p->w[k]      = z->img_comp[k].x;
+      p->h[k]      = z->img_comp[k].y;
+      p->hs[k]     = z->img_h_max / z->img_comp[k].h;
+      p->vs[k]     = z->img_v_max / z->img_comp[k].v;
+      // the planes own the buffer now, so cleanup_jpeg leaves it alone
+      z->img_comp[k].data = NULL;
+   }
+   cleanup_jpeg(z);
+   return 1;
+}
+
+#ifndef STBI_NO_STDIO
+int stbi_jpeg_load_planes(char const *filename, stbi_jpeg_planes *planes)
+{
+   jpeg j;
+   int result;
+   FILE *f = fopen(filename, "rb");
+   if (!f) return e("can't fopen", "Unable to open file");
+   start_file(&j.s, f);
+   result = load_jpeg_planes(&j, planes);
+   fclose(f);
+   return result;
+}
+#endif
+
+int stbi_jpeg_load_planes_from_memory(stbi_uc const *buffer, int len, stbi_jpeg_planes *planes)
+{
+   jpeg j;
+   start_mem(&j.s, buffer,len);
+   return load_jpeg_planes(&j, planes);
+}
+
+void stbi_jpeg_free_planes(stbi_jpeg_planes *planes)
+{
+   int k;
+   for (k=0; k < 3; ++k) {
+      free(planes->raw[k]);
+      planes->raw[k] = NULL;
+      planes->data[k] = NULL;
+   }
+}
+
 #ifndef STBI_NO_STDIO
 int stbi_jpeg_test_file(FILE *f)
 {
@@ -1815,7 +2224,7 @@ static int parse_huffman_block(zbuf *a)
 static int compute_huffman_codes(zbuf *a)
 {
    static uint8 length_dezigzag[19] = { 16,17,18,0,8,7,9,6,10,5,11,4,12,3,13,2,14,1,15 };
-   static zhuffman z_codelength; // static just to save stack space
+   zhuffman z_codelength; // on the stack so concurrent decodes don't share it
    uint8 lencodes[286+32+137];//padding for maximum single op
    uint8 codelength_sizes[19];
    int i,n;
@@ -1900,8 +2309,9 @@ static int parse_zlib_header(zbuf *a)
    return 1;
 }
 
-// @TODO: should statically initialize these for optimal thread safety
+// built once, on first use, by whichever thread gets there first
 static uint8 default_length[288], default_distance[32];
+static stbi_once_t zdefaults_once = STBI_ONCE_INIT;
 static void init_defaults(void)
 {
    int i;   // use <= to match clearly with spec
@@ -1930,7 +2340,7 @@ static int parse_zlib(zbuf *a, int parse_header)
       } else {
          if (type == 1) {
             // use fixed code lengths
-            if (!default_distance[31]) init_defaults();
+            stbi_once(&zdefaults_once, init_defaults);
             if (!zbuild_huffman(&a->z_length  , default_length  , 288)) return 0;
             if (!zbuild_huffman(&a->z_distance, default_distance,  32)) return 0;
          } else {
@@ -2075,6 +2485,223 @@ static int paeth(int a, int b, int c)
    return c;
 }
 
+// SIMD unfiltering for 3- and 4-byte pixels (RGB/RGBA). Sub, Avg and Paeth
+// depend on the pixel just decoded, so those run one pixel per step with the
+// channels in parallel; Up has no such dependency and runs 16 bytes at a time.
+// Output is byte-identical to the scalar loops in create_png_image.
+#ifndef STBI_NO_SIMD
+   #if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+      #define STBI_PNG_SSE2
+      #include <emmintrin.h>
+      #ifdef _MSC_VER
+      #include <intrin.h>
+      #endif
+   #elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+      #define STBI_PNG_NEON
+      #include <arm_neon.h>
+   #endif
+#endif
+
+#if defined(STBI_PNG_SSE2) || defined(STBI_PNG_NEON)
+
+static uint32 load_pixel(uint8 const *p, int n)
+{
+   uint32 v = 0;
+   memcpy(&v, p, n);
+   return v;
+}
+
+static void store_pixel(uint8 *p, uint32 v, int n)
+{
+   memcpy(p, &v, n);
+}
+
+static int cpu_has_simd(void)
+{
+#if defined(STBI_PNG_SSE2) && defined(_MSC_VER)
+   int info[4];
+   __cpuid(info, 1);
+   return (info[3] >> 26) & 1;
+#elif defined(STBI_PNG_SSE2) && defined(__GNUC__) && (defined(__i386__) || defined(__x86_64__))
+   return __builtin_cpu_supports("sse2") != 0;
+#else
+   return 1;
+#endif
+}
+
+#ifdef STBI_PNG_SSE2
+
+static __m128i sse2_abs16(__m128i x)
+{
+   return _mm_max_epi16(x, _mm_sub_epi16(_mm_setzero_si128(), x));
+}
+
+static __m128i sse2_select(__m128i mask, __m128i x, __m128i y)
+{
+   return _mm_or_si128(_mm_and_si128(mask, x), _mm_andnot_si128(mask, y));
+}
+
+static void unfilter_sub(uint8 *cur, uint8 const *raw, uint8 const *prior, uint32 count, int n)
+{
+   __m128i a = _mm_cvtsi32_si128((int) load_pixel(cur-n, n));
+   (void) prior;
+   for (; count; --count, raw += n, cur += n) {
+      a = _mm_add_epi8(a, _mm_cvtsi32_si128((int) load_pixel(raw, n)));
+      store_pixel(cur, (uint32) _mm_cvtsi128_si32(a), n);
+   }
+}
+
+static void unfilter_up(uint8 *cur, uint8 const *raw, uint8 const *prior, uint32 count, int n)
+{
+   uint32 i = 0, len = count * n;
+   for (; i + 16 <= len; i += 16) {
+      __m128i x = _mm_loadu_si128((__m128i const *) (raw + i));
+      __m128i b = _mm_loadu_si128((__m128i const *) (prior + i));
+      _mm_storeu_si128((__m128i *) (cur + i), _mm_add_epi8(x, b));
+   }
+   for (; i < len; ++i)
+      cur[i] = raw[i] + prior[i];
+}
+
+static void unfilter_avg(uint8 *cur, uint8 const *raw, uint8 const *prior, uint32 count, int n)
+{
+   __m128i one = _mm_set1_epi8(1);
+   __m128i a = _mm_cvtsi32_si128((int) load_pixel(cur-n, n));
+   for (; count; --count, raw += n, prior += n, cur += n) {
+      __m128i b = _mm_cvtsi32_si128((int) load_pixel(prior, n));
+      // _mm_avg_epu8 rounds up; drop the carried bit to get (a+b)>>1
+      __m128i avg = _mm_sub_epi8(_mm_avg_epu8(a, b), _mm_and_si128(_mm_xor_si128(a, b), one));
+      a = _mm_add_epi8(avg, _mm_cvtsi32_si128((int) load_pixel(raw, n)));
+      store_pixel(cur, (uint32) _mm_cvtsi128_si32(a), n);
+   }
+}
+
+static void unfilter_paeth(uint8 *cur, uint8 const *raw, uint8 const *prior, uint32 count, int n)
+{
+   __m128i zero = _mm_setzero_si128();
+   __m128i a = _mm_unpacklo_epi8(_mm_cvtsi32_si128((int) load_pixel(cur-n, n)), zero);
+   __m128i c = _mm_unpacklo_epi8(_mm_cvtsi32_si128((int) load_pixel(prior-n, n)), zero);
+   for (; count; --count, raw += n, prior += n, cur += n) {
+      __m128i b = _mm_unpacklo_epi8(_mm_cvtsi32_si128((int) load_pixel(prior, n)), zero);
+      __m128i x = _mm_unpacklo_epi8(_mm_cvtsi32_si128((int) load_pixel(raw, n)), zero);
+      // p = a+b-c, so |p-a| = |b-c|, |p-b| = |a-c|, |p-c| = |a+b-2c|
+      __m128i pa = sse2_abs16(_mm_sub_epi16(b, c));
+      __m128i pb = sse2_abs16(_mm_sub_epi16(a, c));
+      __m128i pc = sse2_abs16(_mm_sub_epi16(_mm_add_epi16(a, b), _mm_add_epi16(c, c)));
+      __m128i smallest = _mm_min_epi16(pc, _mm_min_epi16(pa, pb));
+      // ties go to a, then b, then c
+      __m128i pred = sse2_select(_mm_cmpeq_epi16(pb, smallest), b, c);
+      pred = sse2_select(_mm_cmpeq_epi16(pa, smallest), a, pred);
+      x = _mm_packus_epi16(_mm_and_si128(_mm_add_epi16(x, pred), _mm_set1_epi16(0xff)), zero);
+      store_pixel(cur, (uint32) _mm_cvtsi128_si32(x), n);
+      a = _mm_unpacklo_epi8(x, zero);
+      c = b;
+   }
+}
+
+#else // STBI_PNG_NEON
+
+static uint8x8_t neon_pixel(uint8 const *p, int n)
+{
+   return vreinterpret_u8_u32(vdup_n_u32(load_pixel(p, n)));
+}
+
+static void neon_store(uint8 *p, uint8x8_t v, int n)
+{
+   store_pixel(p, vget_lane_u32(vreinterpret_u32_u8(v), 0), n);
+}
+
+static void unfilter_sub(uint8 *cur, uint8 const *raw, uint8 const *prior, uint32 count, int n)
+{
+   uint8x8_t a = neon_pixel(cur-n, n);
+   (void) prior;
+   for (; count; --count, raw += n, cur += n) {
+      a = vadd_u8(a, neon_pixel(raw, n));
+      neon_store(cur, a, n);
+   }
+}
+
+static void unfilter_up(uint8 *cur, uint8 const *raw, uint8 const *prior, uint32 count, int n)
+{
+   uint32 i = 0, len = count * n;
+   for (; i + 16 <= len; i += 16)
+      vst1q_u8(cur + i, vaddq_u8(vld1q_u8(raw + i), vld1q_u8(prior + i)));
+   for (; i < len; ++i)
+      cur[i] = raw[i] + prior[i];
+}
+
+static void unfilter_avg(uint8 *cur, uint8 const *raw, uint8 const *prior, uint32 count, int n)
+{
+   uint8x8_t a = neon_pixel(cur-n, n);
+   for (; count; --count, raw += n, prior += n, cur += n) {
+      a = vadd_u8(vhadd_u8(a, neon_pixel(prior, n)), neon_pixel(raw, n));
+      neon_store(cur, a, n);
+   }
+}
+
+static void unfilter_paeth(uint8 *cur, uint8 const *raw, uint8 const *prior, uint32 count, int n)
+{
+   int16x8_t a = vreinterpretq_s16_u16(vmovl_u8(neon_pixel(cur-n, n)));
+   int16x8_t c = vreinterpretq_s16_u16(vmovl_u8(neon_pixel(prior-n, n)));
+   for (; count; --count, raw += n, prior += n, cur += n) {
+      int16x8_t b = vreinterpretq_s16_u16(vmovl_u8(neon_pixel(prior, n)));
+      // p = a+b-c, so |p-a| = |b-c|, |p-b| = |a-c|, |p-c| = |a+b-2c|
+      int16x8_t pa = vabdq_s16(b, c);
+      int16x8_t pb = vabdq_s16(a, c);
+      int16x8_t pc = vabdq_s16(vaddq_s16(a, b), vaddq_s16(c, c));
+      int16x8_t smallest = vminq_s16(pc, vminq_s16(pa, pb));
+      // ties go to a, then b, then c
+      int16x8_t pred = vbslq_s16(vceqq_s16(pb, smallest), b, c);
+      uint8x8_t x;
+      pred = vbslq_s16(vceqq_s16(pa, smallest), a, pred);
+      x = vadd_u8(vmovn_u16(vreinterpretq_u16_s16(pred)), neon_pixel(raw, n));
+      neon_store(cur, x, n);
+      a = vreinterpretq_s16_u16(vmovl_u8(x));
+      c = b;
+   }
+}
+
+#endif // STBI_PNG_NEON
+
+static int png_cpu_simd;
+static stbi_once_t png_simd_once = STBI_ONCE_INIT;
+
+static void probe_png_simd(void)
+{
+   png_cpu_simd = cpu_has_simd();
+}
+
+// unfilter pixels 1..count of a row whose first pixel is already done;
+// returns 0 if the caller should fall back to the scalar loop
+static int simd_unfilter_row(int filter, uint8 *cur, uint8 const *raw, uint8 const *prior, uint32 count, int n)
+{
+   stbi_once(&png_simd_once, probe_png_simd);
+   if (!png_cpu_simd || !settings()->png_simd || (n != 3 && n != 4)) return 0;
+   // constant pixel sizes let the pixel loads/stores compile to plain moves
+   switch (filter) {
+      case F_sub  : if (n == 3) unfilter_sub(cur,raw,prior,count,3);   else unfilter_sub(cur,raw,prior,count,4);   return 1;
+      case F_up   : unfilter_up(cur,raw,prior,count,n); return 1;
+      case F_avg  : if (n == 3) unfilter_avg(cur,raw,prior,count,3);   else unfilter_avg(cur,raw,prior,count,4);   return 1;
+      case F_paeth: if (n == 3) unfilter_paeth(cur,raw,prior,count,3); else unfilter_paeth(cur,raw,prior,count,4); return 1;
+   }
+   return 0;
+}
+
+#else
+
+static int simd_unfilter_row(int filter, uint8 *cur, uint8 const *raw, uint8 const *prior, uint32 count, int n)
+{
+   (void) filter; (void) cur; (void) raw; (void) prior; (void) count; (void) n;
+   return 0;
+}
+
+#endif // STBI_PNG_SSE2 || STBI_PNG_NEON
+
+void stbi_png_set_simd(int enable)
+{
+   default_ctx.png_simd = enable;
+}
+
 // create the png data from post-deflated data
 static int create_png_image(png *a, uint8 *raw, uint32 raw_len, int out_n)
 {
@@ -2111,6 +2738,10 @@ static int create_png_image(png *a, uint8 *raw, uint32 raw_len, int out_n)
       prior += out_n;
       // this is a little gross, so that we don't switch per-pixel or per-component
       if (img_n == out_n) {
+         if (simd_unfilter_row(filter, cur, raw, prior, s->img_x-1, img_n)) {
+            raw += (s->img_x-1) * img_n;
+            continue;
+         }
          #define CASE(f) \
              case f:     \
                 for (i=s->img_x-1; i >= 1; --i, raw+=img_n,cur+=img_n,prior+=img_n) \
@@ -2300,6 +2931,7 @@ static int parse_png_file(png *z, int scan, int req_comp)
             else
             #endif
             {
+               if (c.length > (uint32) (s->img_buffer_end - s->img_buffer)) return e("outofdata","Corrupt PNG");
                memcpy(z->idata+ioff, s->img_buffer, c.length);
                s->img_buffer += c.length;
             }
@@ -2337,8 +2969,8 @@ static int parse_png_file(png *z, int scan, int req_comp)
             // if critical, fail
             if ((c.type & (1 << 29)) == 0) {
                #ifndef STBI_NO_FAILURE_STRINGS
-               // not threadsafe
-               static char invalid_chunk[] = "XXXX chunk not known";
+               // per thread, since it outlives the call as the failure reason
+               static STBI_THREAD_LOCAL char invalid_chunk[] = "XXXX chunk not known";
                invalid_chunk[0] = (uint8) (c.type >> 24);
                invalid_chunk[1] = (uint8) (c.type >> 16);
                invalid_chunk[2] = (uint8) (c.type >>  8);
@@ -2522,7 +3154,6 @@ static stbi_uc *bmp_load(stbi *s, int *x, int *y, int *comp, int req_comp)
    offset = get32le(s);
    hsz = get32le(s);
    if (hsz != 12 && hsz != 40 && hsz != 56 && hsz != 108) return epuc("unknown BMP", "BMP type not supported: unknown");
-   failure_reason = "bad BMP";
    if (hsz == 12) {
       s->img_x = get16le(s);
       s->img_y = get16le(s);
@@ -2530,7 +3161,7 @@ static stbi_uc *bmp_load(stbi *s, int *x, int *y, int *comp, int req_comp)
       s->img_x = get32le(s);
       s->img_y = get32le(s);
    }
-   if (get16le(s) != 1) return 0;
+   if (get16le(s) != 1) return epuc("bad BMP", "bad BMP");
    bpp = get16le(s);
    if (bpp == 1) return epuc("monochrome", "BMP type not supported: 1-bit");
    flip_vertically = ((int) s->img_y) > 0;
@@ -2572,10 +3203,10 @@ static stbi_uc *bmp_load(stbi *s, int *x, int *y, int *comp, int req_comp)
                // not documented, but generated by photoshop and handled by mspaint
                if (mr == mg && mg == mb) {
                   // ?!?!?
-                  return NULL;
+                  return epuc("bad BMP", "bad BMP");
                }
             } else
-               return NULL;
+               return epuc("bad BMP", "bad BMP");
          }
       } else {
          assert(hsz == 108);
@@ -153,6 +153,22 @@
 // not), using:
 //
 //     stbi_is_hdr(char *filename);
+//
+// ===========================================================================
+//
+// Threads
+//
+// Decoding is safe from several threads at once. The failure reason is kept
+// per thread, the shared zlib tables are built exactly once, and loader
+// registration is locked. The process-wide settings above (gamma, scale,
+// stbi_png_set_simd) are only read while decoding, so set them up front.
+// To give a load its own settings and error state, use a context:
+//
+//    stbi_context ctx;
+//    stbi_context_init(&ctx);       // copies the process-wide settings
+//    ctx.h2l_gamma_i = 1.0f/1.8f;
+//    data = stbi_load_ctx(&ctx, filename, &x, &y, &n, 0);
+//    if (!data) ... ctx.failure_reason ...
 
 #ifndef STBI_NO_STDIO
 #include <stdio.h>
@@ -172,6 +188,16 @@ enum
 
 typedef unsigned char stbi_uc;
 
+#if defined(_MSC_VER)
+   #define STBI_THREAD_LOCAL __declspec(thread)
+#elif defined(__GNUC__) || defined(__clang__)
+   #define STBI_THREAD_LOCAL __thread
+#elif defined(__STDC_VERSION__) && __STDC_VERSION__ >= 201112L
+   #define STBI_THREAD_LOCAL _Thread_local
+#else
+   #error "stb_image needs thread local storage to keep failure reasons per thread"
+#endif
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -212,10 +238,26 @@ extern void   stbi_ldr_to_hdr_scale(float scale);
 
 #endif // STBI_NO_HDR
 
-// get a VERY brief reason for failure
-// NOT THREADSAFE
+// get a VERY brief reason for failure on the calling thread
 extern char    *stbi_failure_reason  (void); 
 
+// per-call settings and error state; see "Threads" above
+typedef struct
+{
+   float h2l_gamma_i, h2l_scale_i;  // HDR->LDR, already inverted
+   float l2h_gamma, l2h_scale;      // LDR->HDR
+   int   png_simd;                  // allow the SIMD PNG unfilter
+   int   jpeg_threads;              // threads for JPEG restart intervals, 0 = one per CPU
+   char *failure_reason;            // set when a load through this context fails
+} stbi_context;
+
+extern void     stbi_context_init    (stbi_context *ctx);
+extern stbi_uc *stbi_load_from_memory_ctx(stbi_context *ctx, stbi_uc const *buffer, int len, int *x, int *y, int *comp, int req_comp);
+#ifndef STBI_NO_STDIO
+extern stbi_uc *stbi_load_ctx        (stbi_context *ctx, char const *filename, int *x, int *y, int *comp, int req_comp);
+extern stbi_uc *stbi_load_from_file_ctx(stbi_context *ctx, FILE *f,          int *x, int *y, int *comp, int req_comp);
+#endif
+
 // free the loaded image -- this is just free()
 extern void     stbi_image_free      (void *retval_from_stbi_load);
 
@@ -244,6 +286,33 @@ extern int      stbi_jpeg_test_memory     (stbi_uc const *buffer, int len);
 extern stbi_uc *stbi_jpeg_load_from_memory(stbi_uc const *buffer, int len, int *x, int *y, int *comp, int req_comp);
 extern int      stbi_jpeg_info_from_memory(stbi_uc const *buffer, int len, int *x, int *y, int *comp);
 
+// raw JPEG component planes, for callers that want Y/Cb/Cr at their coded
+// resolution instead of upsampled, color-converted RGB. Plane k has w[k] x h[k]
+// valid samples, rows stride[k] bytes apart, and each sample covers
+// hs[k] x vs[k] image pixels. n is 1 (Y only) or 3 (Y, Cb, Cr). Files whose
+// sampling factors don't divide the largest one (h=3 against h=2) are refused.
+typedef struct
+{
+   stbi_uc *data[3];
+   int      stride[3];
+   int      w[3], h[3];
+   int      hs[3], vs[3];
+   int      x, y, n;
+   void    *raw[3];     // allocations behind data[], for stbi_jpeg_free_planes
+} stbi_jpeg_planes;
+
+// returns 0 on failure (see stbi_failure_reason); free with stbi_jpeg_free_planes
+extern int      stbi_jpeg_load_planes_from_memory(stbi_uc const *buffer, int len, stbi_jpeg_planes *planes);
+#ifndef STBI_NO_STDIO
+extern int      stbi_jpeg_load_planes     (char const *filename, stbi_jpeg_planes *planes);
+#endif
+extern void     stbi_jpeg_free_planes     (stbi_jpeg_planes *planes);
+
+// large JPEGs with restart markers have their restart intervals decoded on
+// several threads; 0 (the default) uses one per CPU, 1 always decodes serially.
+// This is the process-wide default; stbi_context.jpeg_threads overrides it per load
+extern void     stbi_jpeg_set_threads     (int threads);
+
 #ifndef STBI_NO_STDIO
 extern stbi_uc *stbi_jpeg_load            (char const *filename,     int *x, int *y, int *comp, int req_comp);
 extern int      stbi_jpeg_test_file       (FILE *f);
@@ -258,6 +327,11 @@ extern int      stbi_png_test_memory      (stbi_uc const *buffer, int len);
 extern stbi_uc *stbi_png_load_from_memory (stbi_uc const *buffer, int len, int *x, int *y, int *comp, int req_comp);
 extern int      stbi_png_info_from_memory (stbi_uc const *buffer, int len, int *x, int *y, int *comp);
 
+// PNG scanlines of 3- and 4-byte pixels are unfiltered with SSE2/NEON when the
+// CPU supports it; pass 0 to force the scalar path (the output is identical).
+// This is the process-wide default; stbi_context.png_simd overrides it per load
+extern void     stbi_png_set_simd         (int enable);
+
 #ifndef STBI_NO_STDIO
 extern stbi_uc *stbi_png_load             (char const *filename,     int *x, int *y, int *comp, int req_comp);
 extern int      stbi_png_info             (char const *filename,     int *x, int *y, int *comp);
@@ -322,7 +396,6 @@ typedef struct
 
 // register a loader by filling out the above structure (you must defined ALL functions)
 // returns 1 if added or already added, 0 if not added (too many loaders)
-// NOT THREADSAFE
 extern int stbi_register_loader(stbi_loader *loader);
 
 // define faster low-level operations (typically SIMD support)
@@ -340,6 +413,7 @@ typedef void (*stbi_YCbCr_to_RGB_run)(uint8 *output, uint8 const *y, uint8 const
 //     cb: Cb input channel; scale/biased to be 0..255
 //     cr: Cr input channel; scale/biased to be 0..255
 
+// install these before any thread starts decoding
 extern void stbi_install_idct(stbi_idct_8x8 func);
 extern void stbi_install_YCbCr_to_RGB(stbi_YCbCr_to_RGB_run func);
 #endif // STBI_SIMD